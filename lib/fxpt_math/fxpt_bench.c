@@ -0,0 +1,159 @@
+/*
+ * Host-side accuracy and speed comparison for fxpt_math.
+ *
+ * This is not part of the firmware build. It links the polynomial
+ * implementation (FXPT_MATH_PRECISION 0) against a table driven one and checks
+ * both against libm across the input range:
+ *
+ *   cc -O2 -c -DFXPT_MATH_PRECISION=0 -Dfxpt_atan2=fxpt_atan2_poly \
+ *      -Dfxpt_asin=fxpt_asin_poly fxpt_math.c -o poly.o
+ *   cc -O2 -c -DFXPT_MATH_PRECISION=5 fxpt_math.c -o lut.o
+ *   cc -O2 -DFXPT_MATH_PRECISION=5 fxpt_bench.c poly.o lut.o -lm -o bench
+ *   ./bench          # accuracy + timing
+ *   ./bench tables   # print the lookup tables for FXPT_MATH_PRECISION
+ *
+ * Host timings only give a relative idea, the divide and multiply costs on AVR
+ * are far more lopsided than on a desktop cpu.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef FXPT_MATH_PRECISION
+#  define FXPT_MATH_PRECISION 5
+#endif
+
+uint16_t fxpt_atan2(const int16_t y, const int16_t x);
+uint16_t fxpt_asin(int16_t x);
+uint16_t fxpt_atan2_poly(const int16_t y, const int16_t x);
+uint16_t fxpt_asin_poly(int16_t x);
+
+typedef struct {
+  double max;
+  double sum;
+  unsigned long count;
+  int16_t worstA;
+  int16_t worstB;
+} error_t;
+
+static void track(error_t *err, double e, int16_t a, int16_t b) {
+  e = fabs(e);
+  err->sum += e * e;
+  err->count++;
+  if (e > err->max) {
+    err->max = e;
+    err->worstA = a;
+    err->worstB = b;
+  }
+}
+
+// Angle error in degrees, both values in 1/65536ths of a turn
+static double turnError(uint16_t got, double expected) {
+  double e = (int16_t)got - expected * 32768 / M_PI;
+  while (e > 32768) e -= 65536;
+  while (e < -32768) e += 65536;
+  return e * 180 / 32768;
+}
+
+// fxpt_asin returns Q15 radians
+static double asinError(uint16_t got, double expected) {
+  double e = (int16_t)got - expected * 32768;
+  while (e > 32768) e -= 65536;
+  while (e < -32768) e += 65536;
+  return e * 180 / (32768 * M_PI);
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static volatile uint16_t sink;
+
+static double timeAtan2(uint16_t (*fn)(int16_t, int16_t)) {
+  double start = now();
+  for (int32_t y = -32768; y < 32768; y += 13) {
+    for (int32_t x = -32768; x < 32768; x += 11) { sink = fn(y, x); }
+  }
+  return now() - start;
+}
+
+static double timeAsin(uint16_t (*fn)(int16_t)) {
+  double start = now();
+  for (int i = 0; i < 64; i++) {
+    for (int32_t x = -32768; x < 32768; x++) { sink = fn(x); }
+  }
+  return now() - start;
+}
+
+static void report(const char *name, error_t *err) {
+  printf("  %-6s max %.4f deg (at %d, %d) rms %.4f deg\n", name, err->max,
+         err->worstA, err->worstB, sqrt(err->sum / err->count));
+}
+
+static void printTable(const char *name, int bits, int recip) {
+  int n = 1 << bits;
+  printf("static const uint16_t %s[] PROGMEM = {", name);
+  for (int k = 0; k <= n; k++) {
+    long v;
+    if (recip) {
+      v = lround(65535 / (1 + (double)k / n));
+    } else {
+      v = lround(atan((double)k / n) * 32768 / M_PI);
+    }
+    printf("%s%s%ld", k ? "," : "", k % 8 ? " " : "\n    ", v);
+  }
+  printf("};\n");
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "tables") == 0) {
+    if (FXPT_MATH_PRECISION == 0) return 1;
+    printTable("atanLut", FXPT_MATH_PRECISION, 0);
+    printTable("recipLut", FXPT_MATH_PRECISION, 1);
+    return 0;
+  }
+  error_t poly = {0}, lut = {0};
+  // Every vector on a coarse grid, plus a dense ring at the magnitudes the
+  // accelerometers actually produce
+  for (int32_t y = -32768; y < 32768; y += 61) {
+    for (int32_t x = -32768; x < 32768; x += 59) {
+      double expected = atan2(y, x);
+      track(&poly, turnError(fxpt_atan2_poly(y, x), expected), y, x);
+      track(&lut, turnError(fxpt_atan2(y, x), expected), y, x);
+    }
+  }
+  for (int r = 16; r <= 16384; r *= 4) {
+    for (int i = 0; i < 65536; i++) {
+      double a = i * 2 * M_PI / 65536;
+      int16_t y = lround(sin(a) * r), x = lround(cos(a) * r);
+      double expected = atan2(y, x);
+      track(&poly, turnError(fxpt_atan2_poly(y, x), expected), y, x);
+      track(&lut, turnError(fxpt_atan2(y, x), expected), y, x);
+    }
+  }
+  printf("fxpt_atan2, precision %d\n", FXPT_MATH_PRECISION);
+  report("poly", &poly);
+  report("lut", &lut);
+
+  memset(&poly, 0, sizeof(poly));
+  memset(&lut, 0, sizeof(lut));
+  for (int32_t x = -32768; x < 32768; x++) {
+    double expected = asin(x / 32768.0);
+    track(&poly, asinError(fxpt_asin_poly(x), expected), x, 0);
+    track(&lut, asinError(fxpt_asin(x), expected), x, 0);
+  }
+  printf("fxpt_asin, every input\n");
+  report("poly", &poly);
+  report("lut", &lut);
+
+  printf("timing (host)\n");
+  printf("  atan2 poly %.3fs lut %.3fs\n", timeAtan2(fxpt_atan2_poly),
+         timeAtan2(fxpt_atan2));
+  printf("  asin  poly %.3fs lut %.3fs\n", timeAsin(fxpt_asin_poly),
+         timeAsin(fxpt_asin));
+  return 0;
+}
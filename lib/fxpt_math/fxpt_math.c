@@ -92,6 +92,131 @@ static inline int16_t q15_div(const int16_t numer, const int16_t denom) {
   return ((int32_t)numer << 15) / denom;
 }
 
+#if FXPT_MATH_PRECISION
+#ifdef __AVR__
+#  include <avr/pgmspace.h>
+#else
+#  ifndef PROGMEM
+#    define PROGMEM
+#  endif
+#  define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#endif
+
+// atan(k / N) in 1/65536ths of a turn and 65535 / (1 + k / N), N entries + 1.
+// Regenerate with fxpt_bench.c (./bench tables) when changing the precision.
+#if FXPT_MATH_PRECISION == 4
+static const uint16_t atanLut[] PROGMEM = {
+    0, 651, 1297, 1933, 2555, 3159, 3742, 4302,
+    4836, 5344, 5826, 6282, 6712, 7117, 7498, 7856,
+    8192};
+static const uint16_t recipLut[] PROGMEM = {
+    65535, 61680, 58253, 55187, 52428, 49931, 47662, 45590,
+    43690, 41942, 40329, 38836, 37449, 36157, 34952, 33825,
+    32768};
+#elif FXPT_MATH_PRECISION == 5
+static const uint16_t atanLut[] PROGMEM = {
+    0, 326, 651, 975, 1297, 1617, 1933, 2246,
+    2555, 2860, 3159, 3453, 3742, 4025, 4302, 4572,
+    4836, 5094, 5344, 5589, 5826, 6058, 6282, 6500,
+    6712, 6917, 7117, 7310, 7498, 7679, 7856, 8026,
+    8192};
+static const uint16_t recipLut[] PROGMEM = {
+    65535, 63549, 61680, 59918, 58253, 56679, 55187, 53772,
+    52428, 51149, 49931, 48770, 47662, 46603, 45590, 44620,
+    43690, 42798, 41942, 41120, 40329, 39568, 38836, 38129,
+    37449, 36792, 36157, 35544, 34952, 34379, 33825, 33288,
+    32768};
+#elif FXPT_MATH_PRECISION == 6
+static const uint16_t atanLut[] PROGMEM = {
+    0, 163, 326, 489, 651, 813, 975, 1136,
+    1297, 1457, 1617, 1775, 1933, 2090, 2246, 2401,
+    2555, 2708, 2860, 3010, 3159, 3307, 3453, 3599,
+    3742, 3884, 4025, 4164, 4302, 4438, 4572, 4705,
+    4836, 4966, 5094, 5220, 5344, 5467, 5589, 5708,
+    5826, 5943, 6058, 6171, 6282, 6392, 6500, 6607,
+    6712, 6815, 6917, 7018, 7117, 7214, 7310, 7405,
+    7498, 7589, 7679, 7768, 7856, 7942, 8026, 8110,
+    8192};
+static const uint16_t recipLut[] PROGMEM = {
+    65535, 64527, 63549, 62601, 61680, 60786, 59918, 59074,
+    58253, 57455, 56679, 55923, 55187, 54471, 53772, 53092,
+    52428, 51781, 51149, 50533, 49931, 49344, 48770, 48210,
+    47662, 47126, 46603, 46091, 45590, 45099, 44620, 44150,
+    43690, 43240, 42798, 42366, 41942, 41527, 41120, 40721,
+    40329, 39945, 39568, 39199, 38836, 38479, 38129, 37786,
+    37449, 37117, 36792, 36472, 36157, 35848, 35544, 35246,
+    34952, 34663, 34379, 34100, 33825, 33554, 33288, 33026,
+    32768};
+#else
+#  error "FXPT_MATH_PRECISION must be 0 (polynomial) or 4 - 6"
+#endif
+
+#define FXPT_LUT_SIZE (1 << FXPT_MATH_PRECISION)
+
+/**
+ * Linearly interpolate between two neighbouring table entries.
+ *
+ * @param table lookup table in program memory
+ * @param index upper bits of the input
+ * @param frac remaining bits of the input, as a fraction of 65536
+ */
+static inline uint16_t lut_lerp(const uint16_t *table, uint8_t index,
+                                uint16_t frac) {
+  const uint16_t a = pgm_read_word(table + index);
+  const uint16_t b = pgm_read_word(table + index + 1);
+  if (a < b) return a + (((uint32_t)(b - a) * frac) >> 16);
+  return a - (((uint32_t)(a - b) * frac) >> 16);
+}
+
+/**
+ * First octant arctangent of small / large, replacing the divide with a
+ * reciprocal table lookup and a multiply.
+ *
+ * @param small magnitude of the shorter side
+ * @param large magnitude of the longer side, must be non zero
+ * @return angle from 0 to 8192 (1/8th of a turn)
+ */
+static uint16_t atan_octant(uint16_t small, uint16_t large) {
+  // normalise so large is in [1, 2) as Q15, small keeps the same ratio
+  if (!(large & 0xFF00)) {
+    large <<= 8;
+    small <<= 8;
+  }
+  while (!(large & 0x8000)) {
+    large <<= 1;
+    small <<= 1;
+  }
+  const uint16_t recip =
+      lut_lerp(recipLut, (large >> (15 - FXPT_MATH_PRECISION)) & (FXPT_LUT_SIZE - 1),
+               large << (FXPT_MATH_PRECISION + 1));
+  uint32_t ratio = ((uint32_t)small * recip) >> 15;
+  if (ratio > 0xFFFF) ratio = 0xFFFF;
+  return lut_lerp(atanLut, ratio >> (16 - FXPT_MATH_PRECISION),
+                  ratio << FXPT_MATH_PRECISION);
+}
+
+/**
+ * Integer square root, rounded down.
+ *
+ * @param v value to take the square root of
+ * @return floor(sqrt(v))
+ */
+static uint16_t u32_sqrt(uint32_t v) {
+  uint32_t res = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > v) bit >>= 2;
+  while (bit) {
+    if (v >= res + bit) {
+      v -= res + bit;
+      res = (res >> 1) + bit;
+    } else {
+      res >>= 1;
+    }
+    bit >>= 2;
+  }
+  return res;
+}
+
 /**
  * 16-bit fixed point four-quadrant arctangent. Given some Cartesian vector
  * (x, y), find the angle subtended by the vector and the positive x-axis.
@@ -107,6 +232,44 @@ static inline int16_t q15_div(const int16_t numer, const int16_t denom) {
  * @param x x-coordinate in signed 16-bit
  * @return angle in (val / 32768) * pi radian increments from 0x0000 to 0xFFFF
  */
+uint16_t fxpt_atan2(const int16_t y, const int16_t x) {
+  // magnitudes as unsigned so that -32768 is representable
+  const uint16_t abs_y = y < 0 ? -(uint16_t)y : y;
+  const uint16_t abs_x = x < 0 ? -(uint16_t)x : x;
+  if (!abs_x && !abs_y) return 0;
+  uint16_t angle;
+  if (abs_y <= abs_x) { // octants 1, 4, 5, 8
+    angle = atan_octant(abs_y, abs_x);
+  } else { // octants 2, 3, 6, 7
+    angle = 16384 - atan_octant(abs_x, abs_y);
+  }
+  if (x < 0) angle = 32768 - angle;
+  if (y < 0) angle = -angle;
+  return angle;
+}
+
+/**
+ * Arcsine computed as atan2(x, sqrt(1 - x^2)) so that it stays accurate close
+ * to +-1, where the polynomial diverges.
+ *
+ * @param x Q15 value
+ * @return asin(x) in Q15 radians, matching the polynomial version
+ */
+uint16_t fxpt_asin(int16_t x) {
+  const uint16_t abs_x = x < 0 ? -(uint16_t)x : x;
+  if (!abs_x) return 0;
+  const uint16_t cos_x = u32_sqrt((1UL << 30) - (uint32_t)abs_x * abs_x);
+  uint16_t angle;
+  if (abs_x <= cos_x) {
+    angle = atan_octant(abs_x, cos_x);
+  } else {
+    angle = 16384 - atan_octant(cos_x, abs_x);
+  }
+  // 1/65536ths of a turn to Q15 radians is a multiply by pi
+  const uint16_t rad = ((uint32_t)angle * 205887) >> 16;
+  return x < 0 ? -rad : rad;
+}
+#else
 uint16_t fxpt_atan2(const int16_t y, const int16_t x) {
   if (x == y) {  // x/y or y/x would return -1 since 1 isn't representable
     if (y > 0) { // 1/8
@@ -161,4 +324,5 @@ uint16_t fxpt_asin(int16_t x) {
                          x2),
                  x) +
          x;
-}
\ No newline at end of file
+}
+#endif
@@ -26,6 +26,11 @@
 #include <math.h>
 #include <stdint.h>
 
+// Table size used by fxpt_atan2 and fxpt_asin, as 2^n entries (4 - 6). Larger
+// tables cost flash for accuracy. 0 falls back to the polynomial versions.
+#ifndef FXPT_MATH_PRECISION
+#  define FXPT_MATH_PRECISION 5
+#endif
 
 /**
  * 16-bit fixed point four-quadrant arctangent. Given some Cartesian vector
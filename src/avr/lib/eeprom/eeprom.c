@@ -70,6 +70,14 @@ Configuration_t loadConfig(void) {
   if (config.main.version < 15) {
     config.debounce.combinedStrum = false;
   }
+  if (config.main.version < 16) { config.sofLeadTime = SOF_LEAD_TIME; }
+  if (config.main.version < 17) {
+    memcpy_P(&config.mpu, &default_config.mpu, sizeof(default_config.mpu));
+  }
+  if (config.main.version < 18) {
+    memcpy_P(&config.midiVelocityCurve, &default_config.midiVelocityCurve,
+             sizeof(default_config.midiVelocityCurve));
+  }
   if (config.main.version < CONFIG_VERSION) {
     config.main.version = CONFIG_VERSION;
     eeprom_update_block(&config, &config_pointer, sizeof(Configuration_t));
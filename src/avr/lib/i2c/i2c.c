@@ -31,6 +31,7 @@
 
 // === MODIFIED ===
 #include "i2c/i2c.h"
+#include "timer/timer.h"
 #include "util/util.h"
 #include <util/delay.h>
 
@@ -49,6 +50,30 @@ static volatile uint8_t twi_masterBufferLength;
 
 static volatile uint8_t twi_error;
 
+// Internal states for an asynchronous read, these are all reported as
+// TWI_ASYNC_BUSY
+#define TWI_ASYNC_WRITE 4
+#define TWI_ASYNC_WAIT 5
+#define TWI_ASYNC_READ 6
+// Time to wait between writing the pointer and reading, in timer 0 ticks
+#define TWI_ASYNC_DELAY_TICKS (180 / (64 / clockCyclesPerMicrosecond()))
+// Give up on an asynchronous read if it hasn't completed in this time (ms)
+#define TWI_ASYNC_TIMEOUT 10
+// Longest asynchronous read, enough for a high res Wii extension frame
+#define TWI_ASYNC_BUFFER_LENGTH 8
+static volatile uint8_t twi_asyncState = TWI_ASYNC_IDLE;
+static uint8_t twi_asyncAddress;
+static uint8_t twi_asyncLength;
+static unsigned long twi_asyncStart;
+// A finished read is copied here, as blocking transfers reuse the master
+// buffer before the result is collected
+static uint8_t twi_asyncBuffer[TWI_ASYNC_BUFFER_LENGTH];
+
+// TWBR for each speed. SCL Frequency = F_CPU / (16 + (2 * TWBR)), so at 16mhz
+// this is 1mhz, 615khz, 444khz and 100khz. The datasheet recommends a TWBR of
+// at least 10, but plenty of extensions are happy to go faster.
+static const uint8_t twi_speedTWBR[TWI_SPEED_COUNT] = {0, 5, 10, 72};
+
 // === MODIFIED ===
 static uint16_t TIMEOUT = 32767;
 
@@ -84,7 +109,7 @@ void twi_init(void) {
   // TWI_FREQ results in a TWBR of > 10 at 8mhz, so we need to round it to 10.
 // #if F_CPU < 9000000UL
 // Just run at the max speed we can
-  TWBR = 10;
+  TWBR = twi_speedTWBR[TWI_SPEED_DEFAULT];
 // #else
   /* twi bit rate formula from atmega128 manual pg 204
   SCL Frequency = CPU Clock Frequency / (16 + (2 * TWBR))
@@ -97,6 +122,17 @@ void twi_init(void) {
   TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA);
 }
 
+/*
+ * Function twi_setSpeed
+ * Desc     changes the twi bitrate
+ * Input    speed: index into the speed table, 0 is the fastest
+ * Output   none
+ */
+void twi_setSpeed(uint8_t speed) {
+  if (speed >= TWI_SPEED_COUNT) speed = TWI_SPEED_COUNT - 1;
+  TWBR = twi_speedTWBR[speed];
+}
+
 /*
  * Function twi_disable
  * Desc     disables twi pins
@@ -407,6 +443,82 @@ void twi_releaseBus(void) {
   twi_state = TWI_READY;
 }
 
+/*
+ * Function twi_startReadFromPointerSlow
+ * Desc     asynchronous version of twi_readFromPointerSlow. The pointer is
+ *          written, timer 0's compare interrupt waits out the delay and then
+ *          the read is started, so the whole sequence runs from interrupts.
+ * Input    address: 7bit i2c device address
+ *          pointer: register to read from
+ *          length: number of bytes to read
+ * Output   true if the read was started
+ */
+bool twi_startReadFromPointerSlow(uint8_t address, uint8_t pointer,
+                                  uint8_t length) {
+  if (TWI_ASYNC_BUFFER_LENGTH < length || TWI_READY != twi_state ||
+      twi_inRepStart || twi_asyncState >= TWI_ASYNC_WRITE) {
+    return false;
+  }
+  twi_asyncAddress = address;
+  twi_asyncLength = length;
+  twi_asyncStart = millis();
+  twi_asyncState = TWI_ASYNC_WRITE;
+
+  twi_state = TWI_MTX;
+  twi_sendStop = true;
+  twi_error = 0xFF;
+  twi_masterBufferIndex = 0;
+  twi_masterBufferLength = 1;
+  twi_masterBuffer[0] = pointer;
+  twi_slarw = TW_WRITE;
+  twi_slarw |= address << 1;
+  TWCR = _BV(TWINT) | _BV(TWEA) | _BV(TWEN) | _BV(TWIE) | _BV(TWSTA);
+  return true;
+}
+
+/*
+ * Function twi_pollReadFromPointer
+ * Desc     checks on a read started by twi_startReadFromPointerSlow
+ * Input    data: pointer to byte array, filled in once the read is done
+ * Output   TWI_ASYNC_BUSY while the read is in progress, otherwise the result
+ *          of the read (TWI_ASYNC_DONE or TWI_ASYNC_ERROR), or TWI_ASYNC_IDLE
+ *          if nothing was started. Once a result is returned the next read
+ *          can be started.
+ */
+uint8_t twi_pollReadFromPointer(uint8_t *data) {
+  uint8_t state = twi_asyncState;
+  if (state >= TWI_ASYNC_WRITE) {
+    if (millis() - twi_asyncStart < TWI_ASYNC_TIMEOUT) return TWI_ASYNC_BUSY;
+    // The bus has hung, so give up on this read
+    cbi(TIMSK0, OCIE0B);
+    twi_releaseBus();
+    state = TWI_ASYNC_ERROR;
+  }
+  if (state == TWI_ASYNC_DONE) {
+    memcpy(data, twi_asyncBuffer, twi_asyncLength);
+  }
+  twi_asyncState = TWI_ASYNC_IDLE;
+  return state;
+}
+
+static void twi_asyncError(void) {
+  if (twi_asyncState >= TWI_ASYNC_WRITE) { twi_asyncState = TWI_ASYNC_ERROR; }
+}
+
+ISR(TIMER0_COMPB_vect) {
+  // One shot, wait for the next read to reenable this
+  cbi(TIMSK0, OCIE0B);
+  twi_asyncState = TWI_ASYNC_READ;
+  twi_state = TWI_MRX;
+  twi_sendStop = true;
+  twi_error = 0xFF;
+  twi_masterBufferIndex = 0;
+  twi_masterBufferLength = twi_asyncLength - 1;
+  twi_slarw = TW_READ;
+  twi_slarw |= twi_asyncAddress << 1;
+  TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT) | _BV(TWSTA);
+}
+
 ISR(TWI_vect) {
   switch (TW_STATUS) {
   // All Master
@@ -426,9 +538,18 @@ ISR(TWI_vect) {
       TWDR = twi_masterBuffer[twi_masterBufferIndex++];
       twi_reply(1);
     } else {
-      if (twi_sendStop)
+      if (twi_sendStop) {
         twi_stop();
-      else {
+        if (twi_asyncState == TWI_ASYNC_WRITE) {
+          // The pointer has been written, keep other transactions off the bus
+          // and start the timer for the read
+          twi_state = TWI_WAIT;
+          twi_asyncState = TWI_ASYNC_WAIT;
+          OCR0B = TCNT0 + TWI_ASYNC_DELAY_TICKS;
+          sbi(TIFR0, OCF0B);
+          sbi(TIMSK0, OCIE0B);
+        }
+      } else {
         twi_inRepStart = true; // we're gonna send the START
         // don't enable the interrupt. We'll generate the start, but we
         // avoid handling the interrupt until we're in the next transaction,
@@ -441,14 +562,17 @@ ISR(TWI_vect) {
   case TW_MT_SLA_NACK: // address sent, nack received
     twi_error = TW_MT_SLA_NACK;
     twi_stop();
+    twi_asyncError();
     break;
   case TW_MT_DATA_NACK: // data sent, nack received
     twi_error = TW_MT_DATA_NACK;
     twi_stop();
+    twi_asyncError();
     break;
   case TW_MT_ARB_LOST: // lost bus arbitration
     twi_error = TW_MT_ARB_LOST;
     twi_releaseBus();
+    twi_asyncError();
     break;
 
   // Master Receiver
@@ -466,9 +590,13 @@ ISR(TWI_vect) {
   case TW_MR_DATA_NACK: // data received, nack sent
     // put final byte into buffer
     twi_masterBuffer[twi_masterBufferIndex++] = TWDR;
-    if (twi_sendStop)
+    if (twi_sendStop) {
       twi_stop();
-    else {
+      if (twi_asyncState == TWI_ASYNC_READ) {
+        memcpy(twi_asyncBuffer, twi_masterBuffer, twi_asyncLength);
+        twi_asyncState = TWI_ASYNC_DONE;
+      }
+    } else {
       twi_inRepStart = true; // we're gonna send the START
       // don't enable the interrupt. We'll generate the start, but we
       // avoid handling the interrupt until we're in the next transaction,
@@ -479,6 +607,7 @@ ISR(TWI_vect) {
     break;
   case TW_MR_SLA_NACK: // address sent, nack received
     twi_stop();
+    twi_asyncError();
     break;
   // TW_MR_ARB_LOST handled by TW_MT_ARB_LOST case
 
@@ -488,6 +617,7 @@ ISR(TWI_vect) {
   case TW_BUS_ERROR: // bus error, illegal stop/start
     twi_error = TW_BUS_ERROR;
     twi_stop();
+    twi_asyncError();
     break;
   }
 }
\ No newline at end of file
@@ -26,8 +26,15 @@ extern const uint8_t PROGMEM analog_pin_to_channel_PGM[];
 #define portModeRegister(P)                                                    \
   ((volatile uint8_t *)(pgm_read_word(port_to_mode_PGM + (P))))
 int validAnalog = 0;
-int currentAnalog = 0;
-bool first = true;
+// The ADC is scanned from its interrupt, moving to the next analog pin after
+// each conversion. Results for a sweep are written to one buffer while the
+// other buffer holds the last complete sweep.
+volatile uint8_t currentAnalog = 0;
+volatile int16_t adcBuffers[2][NUM_ANALOG_INPUTS];
+volatile uint8_t adcReadBuffer = 0;
+volatile uint8_t adcSequence = 0;
+uint8_t lastAdcSequence = 0;
+bool adcRunning = false;
 Pin_t setUpDigital(Configuration_t *config, uint8_t pinNum, uint8_t offset,
                    bool inverted, bool output) {
   Pin_t pin = {};
@@ -61,6 +68,8 @@ void digitalWritePin(Pin_t pin, bool value) {
     *pin.port |= pin.mask;
   }
 }
+const volatile PortWord_t *pinPortRegister(Pin_t pin) { return pin.port; }
+PortWord_t pinPortMask(Pin_t pin) { return pin.mask; }
 void digitalWrite(uint8_t pin, uint8_t val) {
   uint8_t bit = digitalPinToBitMask(pin);
   uint8_t port = digitalPinToPort(pin);
@@ -127,41 +136,70 @@ void setUpAnalogDigitalPin(Pin_t *button, uint8_t pin, uint16_t threshold) {
   ret.pin = pin;
   joyData[validAnalog++] = ret;
 }
-void tickAnalog(void) {
-  if (validAnalog == 0) return;
-  if (!first) {
-    if (bit_is_set(ADCSRA, ADSC)) return;
-    uint8_t low, high;
-    low = ADCL;
-    high = ADCH;
-    int16_t data = (high << 8) | low;
-    AnalogInfo_t *info = &joyData[currentAnalog];
-    if (!info->hasDigital) {
-      data = data - 512;
-      if (info->inverted) data = -data;
-    }
-    data = data * 64;
-    info->value = data;
-    currentAnalog++;
-    if (currentAnalog == validAnalog) { currentAnalog = 0; }
-  }
-  first = false;
-  AnalogInfo_t info = joyData[currentAnalog];
-
+static inline void selectADCChannel(uint8_t pin) {
 #if defined(ADCSRB) && defined(MUX5)
   // the MUX5 bit of ADCSRB selects whether we're reading from channels
   // 0 to 7 (MUX5 low) or 8 to 15 (MUX5 high).
-  ADCSRB = (ADCSRB & ~(1 << MUX5)) | (((info.pin >> 3) & 0x01) << MUX5);
+  ADCSRB = (ADCSRB & ~(1 << MUX5)) | (((pin >> 3) & 0x01) << MUX5);
 #endif
 
   // set the analog reference (high two bits of ADMUX) and select the
   // channel (low 4 bits).  this also sets ADLAR (left-adjust result)
   // to 0 (the default).
 
-  ADMUX = (1 << 6) | (info.pin & 0x07);
-
+  ADMUX = (1 << 6) | (pin & 0x07);
+}
+ISR(ADC_vect) {
+  uint8_t low, high;
+  low = ADCL;
+  high = ADCH;
+  uint8_t current = currentAnalog;
+  adcBuffers[!adcReadBuffer][current] = (high << 8) | low;
+  current++;
+  if (current == validAnalog) {
+    current = 0;
+    adcReadBuffer = !adcReadBuffer;
+    adcSequence++;
+  }
+  currentAnalog = current;
+  selectADCChannel(joyData[current].pin);
+  sbi(ADCSRA, ADSC);
+}
+void startADCScan(void) {
+  currentAnalog = 0;
+  adcRunning = true;
+  selectADCChannel(joyData[0].pin);
+  sbi(ADCSRA, ADIF);
+  sbi(ADCSRA, ADIE);
   sbi(ADCSRA, ADSC);
 }
+void tickAnalog(void) {
+  if (validAnalog == 0) return;
+  if (!adcRunning) {
+    startADCScan();
+    return;
+  }
+  // Only convert results once a new sweep has completed
+  uint8_t seq = adcSequence;
+  if (seq == lastAdcSequence) return;
+  int16_t data;
+  do {
+    seq = adcSequence;
+    for (uint8_t i = 0; i < validAnalog; i++) {
+      data = adcBuffers[adcReadBuffer][i];
+      AnalogInfo_t *info = &joyData[i];
+      if (!info->hasDigital) {
+        data = data - 512;
+        if (info->inverted) data = -data;
+      }
+      data = data * 64;
+      info->value = data;
+    }
+    // If the interrupt finished another sweep while we were copying, then
+    // the buffer we were reading from may have been overwritten.
+  } while (seq != adcSequence);
+  lastAdcSequence = seq;
+}
 
 uint16_t analogRead(uint8_t pin) {
   uint8_t low, high;
@@ -228,9 +266,10 @@ uint16_t analogRead(uint8_t pin) {
   return (high << 8) | low;
 }
 void stopReading(void) {
+  cbi(ADCSRA, ADIE);
   while (bit_is_set(ADCSRA, ADSC))
     ;
-  first = true;
+  adcRunning = false;
 }
 void pinMode(uint8_t pin, uint8_t mode) {
   uint8_t bit = digitalPinToBitMask(pin);
@@ -295,13 +334,10 @@ void setupADC(void) {
   // enable a2d conversions
   sbi(ADCSRA, ADEN);
 #endif
-  // Enable adc interrupts
-  // sbi(ADCSRA, ADIE);
 }
 
 void setUpValidPins(Configuration_t *config) {
   stopReading();
   validAnalog = 0;
-  currentAnalog = 0;
   for (int i = 0; i < 6; i++) { setUpAnalogPin(config, i); }
 }
\ No newline at end of file
@@ -17,9 +17,9 @@
 #include "usb/usb.h"
 #include "util/util.h"
 #include <stdlib.h>
+#include <util/atomic.h>
 #define ARDUINO_MAIN
 #include "pins_arduino.h"
-Controller_t prevController;
 Controller_t controller;
 USB_Report_Data_t currentReport;
 uint8_t size;
@@ -30,11 +30,27 @@ bool typeIsDrum;
 long lastPoll = 0;
 uint8_t inputType;
 uint8_t pollRate;
+uint16_t sofLeadTime;
+volatile unsigned long lastSof = 0;
+volatile bool sofPending = false;
+// Returns true once per frame, once we are within sofLeadTime us of the next
+// frame starting.
+bool sofReady(void) {
+  // lastSof is written by the SOF interrupt and takes several reads, so keep
+  // it from changing part way through
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (!sofPending || micros() - lastSof < 1000 - sofLeadTime) return false;
+    sofPending = false;
+  }
+  return true;
+}
 void initialise(void) {
   Configuration_t config = loadConfig();
   fullDeviceType = config.main.subType;
   deviceType = fullDeviceType;
   pollRate = config.main.pollRate;
+  sofLeadTime = config.sofLeadTime;
+  if (sofLeadTime > 1000) { sofLeadTime = 1000; }
   inputType = config.main.inputType;
   typeIsDrum = isDrum(fullDeviceType);
   typeIsGuitar = isGuitar(fullDeviceType);
@@ -62,14 +78,16 @@ int main(void) {
   while (true) {
     USB_USBTask();
     if (isRF) {
-      tickRFInput((uint8_t *)&controller, cSize);
+      if (tickRFInput((uint8_t *)&controller, cSize)) {
+        inputChanges = CHANGED_ALL;
+      }
     } else {
       tickInputs(&controller);
       tickLEDs(&controller);
       if (millis() - lastPoll < pollRate) { continue; }
+      if (sofLeadTime && !sofReady()) { continue; }
     }
-    if (memcmp(&controller, &prevController, cSize) != 0 &&
-        Endpoint_IsINReady()) {
+    if ((inputChanges || reportPending) && Endpoint_IsINReady()) {
       fillReport(&currentReport, &size, &controller);
       if (size) {
         lastPoll = millis();
@@ -98,14 +116,20 @@ int main(void) {
           Endpoint_SelectEndpoint(HID_EPADDR_IN);
           break;
         }
-        memcpy(&prevController, &controller, cSize);
         Endpoint_Write_Stream_LE(data, size, NULL);
         Endpoint_ClearIN();
       }
+      // An empty report means the changes had nothing to send
+      inputChanges = 0;
     }
   }
 }
+void EVENT_USB_Device_StartOfFrame(void) {
+  lastSof = micros();
+  sofPending = true;
+}
 void EVENT_USB_Device_ConfigurationChanged(void) {
+  if (sofLeadTime) { USB_Device_EnableSOFEvents(); }
   Endpoint_ConfigureEndpoint(XINPUT_EPADDR_IN, EP_TYPE_INTERRUPT, HID_EPSIZE,
                              1);
   Endpoint_ConfigureEndpoint(HID_EPADDR_IN, EP_TYPE_INTERRUPT, HID_EPSIZE, 1);
@@ -62,7 +62,6 @@ USB_ClassInfo_CDC_Device_t VirtualSerial_CDC_Interface = {
 __attribute__((section(".rfrecv"))) uint32_t rftxID = 0xDEADBEEF;
 __attribute__((section(".rfrecv"))) uint32_t rfrxID = 0xDEADBEEF;
 Controller_t controller;
-Controller_t prevCtrl;
 bool isRF = false;
 bool typeIsGuitar;
 bool typeIsDrum;
@@ -128,8 +127,7 @@ int main(void) {
       tickLEDs(&controller);
       // Since we receive data via acks, we need to make sure data is always
       // being sent, so we send data every 100ms regardless.
-      if (memcmp(&controller, &prevCtrl, sizeof(Controller_t)) != 0 ||
-          millis() - lastPoll > 100) {
+      if (inputChanges || millis() - lastPoll > 100) {
         lastPoll = millis();
 
         uint8_t data[12];
@@ -147,7 +145,7 @@ int main(void) {
             }
           }
         }
-        memcpy(&prevCtrl, &controller, sizeof(Controller_t));
+        inputChanges = 0;
         if (lastButtons != controller.buttons) {
           lastButtons = controller.buttons;
           lastChange = millis();
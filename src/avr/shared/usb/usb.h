@@ -150,7 +150,16 @@ uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
     mods[0] = offsetof(USB_Descriptor_Configuration_t, XInputReserved.subtype);
     mods[1] = deviceType;
     mods[2] = 0x25;
-    write_endpoint_mods(address, size, mods, 3);
+    modCount = 3;
+    // The keyboard report descriptor is shorter than the ps3 one
+    if (deviceType <= KEYBOARD_ROCK_BAND_DRUMS) {
+      mods[3] = offsetof(USB_Descriptor_Configuration_t,
+                         HIDDescriptor.HIDReportLength);
+      mods[4] = sizeof(kbd_report_descriptor) & 0xFF;
+      mods[5] = sizeof(kbd_report_descriptor) >> 8;
+      modCount = sizeof(mods);
+    }
+    write_endpoint_mods(address, size, mods, modCount);
 #ifdef MULTI_ADAPTOR
 // TODO: if we ever implement this stuff, this needs to be implemented again.
 // conf->XInputReserved2.subtype = XINPUT_ARCADE_PAD;
@@ -162,10 +171,11 @@ uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
   case HID_DTYPE_Report:
     if (deviceType <= KEYBOARD_ROCK_BAND_DRUMS) {
       address = kbd_report_descriptor;
+      size = sizeof(kbd_report_descriptor);
     } else {
       address = ps3_report_descriptor;
+      size = sizeof(ps3_report_descriptor);
     }
-    size = sizeof(kbd_report_descriptor);
     break;
   case DTYPE_String:
     if (descriptorNumber <= 3) {
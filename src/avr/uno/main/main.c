@@ -23,7 +23,6 @@
 #include <stdlib.h>
 #include <util/delay.h>
 Controller_t controller;
-Controller_t prevController;
 uint8_t currentReport[sizeof(USB_Report_Data_t)];
 RingBuffer_t in;
 RingBuffer_t out;
@@ -189,21 +188,26 @@ int main(void) {
       // receiver.
     } else if (millis() - lastPoll > pollRate || isRF) {
       if (isRF) {
-        tickRFInput((uint8_t *)&controller, sizeof(XInput_Data_t));
+        if (tickRFInput((uint8_t *)&controller, sizeof(XInput_Data_t))) {
+          inputChanges = CHANGED_ALL;
+        }
       } else {
         tickInputs(&controller);
         tickLEDs(&controller);
       }
       uint8_t size;
-      if (memcmp(&prevController, &controller, sizeof(XInput_Data_t)) != 0 && readyForPacket) {
+      if ((inputChanges || reportPending) && readyForPacket) {
         fillReport(currentReport, &size, &controller);
-        lastPoll = millis();
-        readyForPacket = false;
-        uint8_t done = FRAME_START_WRITE;
-        writeData(&done, 1);
-        writeData(&size, 1);
-        writeData(currentReport, size);
-        memcpy(&prevController, &controller, sizeof(XInput_Data_t));
+        inputChanges = 0;
+        // An empty report means the changes had nothing to send
+        if (size) {
+          lastPoll = millis();
+          readyForPacket = false;
+          uint8_t done = FRAME_START_WRITE;
+          writeData(&done, 1);
+          writeData(&size, 1);
+          writeData(currentReport, size);
+        }
       }
     }
   }
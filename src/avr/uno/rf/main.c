@@ -25,7 +25,6 @@
 #include "controller/guitar_includes.h"
 // Sleep pin: 3
 Controller_t controller;
-Controller_t prevCtrl;
 long lastPoll = 0;
 bool isRF = false;
 bool typeIsGuitar;
@@ -85,8 +84,7 @@ int main(void) {
       tickInputs(&controller);
       // Since we receive data via acks, we need to make sure data is always
       // being sent, so we send data every 100ms regardless.
-      if ((memcmp(&controller, &prevCtrl, sizeof(Controller_t)) != 0 ||
-           millis() - lastPoll > 100)) {
+      if (inputChanges || millis() - lastPoll > 100) {
         lastPoll = millis();
         uint8_t data[32];
         if (tickRFTX((uint8_t *)&controller, data, sizeof(XInput_Data_t))) {
@@ -103,7 +101,7 @@ int main(void) {
             }
           }
         }
-        memcpy(&prevCtrl, &controller, sizeof(Controller_t));
+        inputChanges = 0;
         if (lastButtons != controller.buttons) {
           lastButtons = controller.buttons;
           lastChange = millis();
@@ -48,6 +48,14 @@ Configuration_t loadConfig(void) {
   if (config.main.version < 15) {
     config.debounce.combinedStrum = false;
   }
+  if (config.main.version < 16) { config.sofLeadTime = SOF_LEAD_TIME; }
+  if (config.main.version < 17) {
+    memcpy(&config.mpu, &default_config.mpu, sizeof(default_config.mpu));
+  }
+  if (config.main.version < 18) {
+    memcpy(&config.midiVelocityCurve, &default_config.midiVelocityCurve,
+           sizeof(default_config.midiVelocityCurve));
+  }
   if (config.main.version < CONFIG_VERSION) {
     config.main.version = CONFIG_VERSION;
     writeConfigBlock(0, (uint8_t *)&config, sizeof(Configuration_t));
@@ -59,10 +67,13 @@ void writeConfigBlock(uint16_t offset, const uint8_t *data, uint16_t len) {
   memcpy(newConfig + offset, data, len);
   uint32_t saved_irq;
   if (offset + len >= sizeof(Configuration_t)) {
+    // Core 1 runs from flash while reading inputs, so it needs to be paused
+    pauseInputs();
     saved_irq = save_and_disable_interrupts();
     flash_range_erase(FLASH_TARGET_OFFSET, FLASH_SECTOR_SIZE);
     flash_range_program(FLASH_TARGET_OFFSET, newConfig, sizeof(newConfig));
     restore_interrupts(saved_irq);
+    resumeInputs();
   }
 }
 void readConfigBlock(uint16_t offset, uint8_t *data, uint16_t len) {
@@ -42,6 +42,9 @@
 // === MODIFIED ===
 static uint16_t TIMEOUT = 1000;
 
+static const uint32_t twi_speedFreq[TWI_SPEED_COUNT] = {1000000, 750000,
+                                                        TWI_FREQ, 100000};
+
 /*
  * Function twi_init
  * Desc     readys twi pins and sets twi bitrate
@@ -57,6 +60,17 @@ void twi_init(void) {
   gpio_pull_up(PIN_WIRE_SCL);
 }
 
+/*
+ * Function twi_setSpeed
+ * Desc     changes the twi bitrate
+ * Input    speed: index into the speed table, 0 is the fastest
+ * Output   none
+ */
+void twi_setSpeed(uint8_t speed) {
+  if (speed >= TWI_SPEED_COUNT) speed = TWI_SPEED_COUNT - 1;
+  i2c_set_baudrate(i2c1, twi_speedFreq[speed]);
+}
+
 /*
  * Function twi_disable
  * Desc     disables twi pins
@@ -101,3 +115,27 @@ bool twi_writeTo(uint8_t address, uint8_t *data, uint8_t length, uint8_t wait,
   _delay_us(60);
   return ret > 0;
 }
+
+// The pico reads inputs on its own core, so asynchronous reads are just
+// performed immediately.
+static uint8_t twi_asyncState = TWI_ASYNC_IDLE;
+static uint8_t twi_asyncLength;
+static uint8_t twi_asyncBuffer[TWI_BUFFER_LENGTH];
+bool twi_startReadFromPointerSlow(uint8_t address, uint8_t pointer,
+                                  uint8_t length) {
+  if (TWI_BUFFER_LENGTH < length) return false;
+  twi_asyncLength = length;
+  twi_asyncState = twi_readFromPointerSlow(address, pointer, length,
+                                           twi_asyncBuffer)
+                       ? TWI_ASYNC_DONE
+                       : TWI_ASYNC_ERROR;
+  return true;
+}
+uint8_t twi_pollReadFromPointer(uint8_t *data) {
+  uint8_t state = twi_asyncState;
+  if (state == TWI_ASYNC_DONE) {
+    memcpy(data, twi_asyncBuffer, twi_asyncLength);
+  }
+  twi_asyncState = TWI_ASYNC_IDLE;
+  return state;
+}
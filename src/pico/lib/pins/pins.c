@@ -1,9 +1,23 @@
 #include "pins/pins.h"
 #include "eeprom/eeprom.h"
 #include "hardware/adc.h"
+#include "hardware/dma.h"
 #include "hardware/gpio.h"
 #include "stddef.h"
 #include "util/util.h"
+// The ADC free runs over every channel, and DMA writes the results into a ring
+// buffer. Each channel gets ADC_OVERSAMPLE slots, which are averaged when read.
+#ifndef ADC_OVERSAMPLE
+#  define ADC_OVERSAMPLE 4
+#endif
+#define ADC_CHANNELS 4
+#define ADC_SAMPLES (ADC_CHANNELS * ADC_OVERSAMPLE)
+// Sample each channel at ~10khz (the adc runs at 48mhz)
+#define ADC_CLKDIV (48000000 / (10000 * ADC_CHANNELS) - 1)
+uint16_t adcSamples[ADC_SAMPLES]
+    __attribute__((aligned(ADC_SAMPLES * sizeof(uint16_t))));
+int adcDMA = -1;
+bool adcRunning = false;
 
 void digitalWrite(uint8_t pin, uint8_t val) { gpio_put(pin, val); }
 
@@ -42,12 +56,18 @@ void digitalWritePin(Pin_t pin, bool value) {
   }
   gpio_put(pin.pin, value);
 }
+// All gpios live in a single bank on the pico
+const volatile PortWord_t *pinPortRegister(Pin_t pin) {
+  return &sio_hw->gpio_in;
+}
+PortWord_t pinPortMask(Pin_t pin) { return 1u << pin.pin; }
 void setUpAnalogPin(Configuration_t *config, uint8_t offset) {
   AnalogInfo_t ret = {0};
   ret.offset = offset;
   AnalogPin_t apin = ((PinsCombined_t *)&config->pins)->axis[offset];
   uint8_t pin = apin.pin;
-  if (pin == INVALID_PIN) { return; }
+  // Axes store the adc channel, anything past the last channel is unusable
+  if (pin >= ADC_CHANNELS) { return; }
   if (ret.offset == 5 && typeIsGuitar &&
       config->main.tiltType != ANALOGUE) {
     return;
@@ -59,32 +79,68 @@ void setUpAnalogPin(Configuration_t *config, uint8_t offset) {
   joyData[validAnalog++] = ret;
 }
 void setUpAnalogDigitalPin(Pin_t *button, uint8_t pin, uint16_t threshold) {
+  // Buttons store the gpio, which has to be turned into an adc channel. Pins
+  // that have no channel are left as a digital pin.
+  uint8_t channel = pin - PIN_A0;
+  if (pin < PIN_A0 || channel >= ADC_CHANNELS) { return; }
   AnalogInfo_t ret = {0};
   ret.offset = pin;
   ret.hasDigital = true;
   ret.threshold = threshold;
-  ret.pin = pin;
-  pinMode(PIN_A0 + pin, INPUT);
+  ret.pin = channel;
+  pinMode(pin, INPUT);
   button->analogOffset = validAnalog;
   joyData[validAnalog++] = ret;
 }
+void startADCScan(void) {
+  adc_run(false);
+  // Wait for any in progress conversion, so that the ring buffer stays aligned
+  // with the channels
+  while (!(adc_hw->cs & ADC_CS_READY_BITS)) tight_loop_contents();
+  adc_fifo_drain();
+  dma_channel_config c = dma_channel_get_default_config(adcDMA);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+  channel_config_set_read_increment(&c, false);
+  channel_config_set_write_increment(&c, true);
+  channel_config_set_ring(&c, true, __builtin_ctz(sizeof(adcSamples)));
+  channel_config_set_dreq(&c, DREQ_ADC);
+  dma_channel_configure(adcDMA, &c, adcSamples, &adc_hw->fifo, UINT32_MAX,
+                        true);
+  adc_select_input(0);
+  adc_run(true);
+  adcRunning = true;
+}
+// Average the latest samples for a channel, returning a 12 bit value
+uint16_t readADCChannel(uint8_t channel) {
+  uint32_t total = 0;
+  for (int i = channel; i < ADC_SAMPLES; i += ADC_CHANNELS) {
+    total += adcSamples[i];
+  }
+  return total / ADC_OVERSAMPLE;
+}
 void tickAnalog(void) {
   if (validAnalog == 0) return;
+  // The transfer count is huge, but restart the scan if it ever runs out
+  if (!adcRunning || !dma_channel_is_busy(adcDMA)) { startADCScan(); }
   for (int i = 0; i < validAnalog; i++) {
     AnalogInfo_t *info = &joyData[i];
-    uint16_t data = analogRead(info->pin - PIN_A0);
+    uint16_t data = readADCChannel(info->pin);
     if (!joyData[i].hasDigital) {
       if (info->inverted) data *= -1;
-      data = (data - 512) * 64;
+      data = (data - 2048) * 16;
+    } else {
+      // Drum thresholds are configured for 10 bits
+      data >>= 2;
     }
     info->value = data;
   }
 }
 
 uint16_t analogRead(uint8_t pin) {
-  adc_select_input(pin + PIN_A0);
   // We have everything coded assuming 10 bits (as that is what the arduino
   // uses) so shift accordingly (12 -> 10)
+  if (adcRunning) { return readADCChannel(pin) >> 2; }
+  adc_select_input(pin);
   return adc_read() >> 2;
 }
 void pinMode(uint8_t pin, uint8_t mode) {
@@ -97,7 +153,18 @@ void pinMode(uint8_t pin, uint8_t mode) {
   }
 }
 
-void setupADC(void) { adc_init(); }
+void setupADC(void) {
+  if (adcRunning) {
+    adc_run(false);
+    dma_channel_abort(adcDMA);
+    adcRunning = false;
+  }
+  adc_init();
+  adc_set_round_robin((1 << ADC_CHANNELS) - 1);
+  adc_fifo_setup(true, true, 1, false, false);
+  adc_set_clkdiv(ADC_CLKDIV);
+  if (adcDMA < 0) { adcDMA = dma_claim_unused_channel(true); }
+}
 
 void setUpValidPins(Configuration_t *config) {
   for (int i = 0; i < 6; i++) { setUpAnalogPin(config, i); }
@@ -0,0 +1,128 @@
+#include "spi/ps2.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/pio.h"
+#include "pins_arduino.h"
+#include "ps2.pio.h"
+#include "timer/timer.h"
+#include <string.h>
+
+// pio0 is left for SPI
+#define PS2_PIO pio1
+#define PS2_SM 0
+// Each bit takes 8 PIO cycles
+#define PS2_CLOCK 250000
+// A full frame takes under 3ms, so anything longer means the controller is
+// holding acknowledge low and the state machine needs a reset (us)
+#define PS2_FRAME_TIMEOUT 5000
+// Sent once the command itself has been shifted out
+#define PS2_PADDING 0x5A
+#define PS2_OUTPUTS                                                            \
+  ((1u << PIN_SPI_SCK) | (1u << PIN_SPI_MOSI) | (1u << PIN_PS2_ATT))
+
+uint8_t ps2Tx[PS2_BUFFER_SIZE];
+uint8_t ps2Rx[PS2_BUFFER_SIZE];
+pio_sm_config ps2Config;
+uint ps2Offset;
+int ps2TxDMA = -1;
+int ps2RxDMA = -1;
+bool ps2Busy = false;
+unsigned long ps2Start;
+
+void resetPS2Engine(void) {
+  dma_channel_abort(ps2TxDMA);
+  dma_channel_abort(ps2RxDMA);
+  pio_sm_init(PS2_PIO, PS2_SM, ps2Offset, &ps2Config);
+  // Clock, command and attention all idle high
+  pio_sm_set_pins_with_mask(PS2_PIO, PS2_SM, PS2_OUTPUTS, PS2_OUTPUTS);
+  pio_interrupt_clear(PS2_PIO, 0);
+  pio_sm_set_enabled(PS2_PIO, PS2_SM, true);
+  ps2Busy = false;
+}
+void ps2_begin(void) {
+  if (ps2TxDMA >= 0) {
+    resetPS2Engine();
+    return;
+  }
+  ps2Offset = pio_add_program(PS2_PIO, &ps2_program);
+  ps2Config = ps2_program_get_default_config(ps2Offset);
+  sm_config_set_out_pins(&ps2Config, PIN_SPI_MOSI, 1);
+  sm_config_set_in_pins(&ps2Config, PIN_SPI_MISO);
+  sm_config_set_set_pins(&ps2Config, PIN_PS2_ATT, 1);
+  sm_config_set_sideset_pins(&ps2Config, PIN_SPI_SCK);
+  sm_config_set_jmp_pin(&ps2Config, PIN_PS2_ACK);
+  // LSB first, and the program does its own pushes and pulls
+  sm_config_set_out_shift(&ps2Config, true, false, 32);
+  sm_config_set_in_shift(&ps2Config, true, false, 32);
+  sm_config_set_clkdiv(&ps2Config,
+                       (float)clock_get_hz(clk_sys) / (PS2_CLOCK * 8));
+  pio_sm_set_pindirs_with_mask(
+      PS2_PIO, PS2_SM, PS2_OUTPUTS,
+      PS2_OUTPUTS | (1u << PIN_SPI_MISO) | (1u << PIN_PS2_ACK));
+  pio_gpio_init(PS2_PIO, PIN_SPI_SCK);
+  pio_gpio_init(PS2_PIO, PIN_SPI_MOSI);
+  pio_gpio_init(PS2_PIO, PIN_PS2_ATT);
+  // Data and acknowledge are open collector
+  gpio_init(PIN_SPI_MISO);
+  gpio_pull_up(PIN_SPI_MISO);
+  gpio_init(PIN_PS2_ACK);
+  gpio_pull_up(PIN_PS2_ACK);
+
+  ps2TxDMA = dma_claim_unused_channel(true);
+  dma_channel_config c = dma_channel_get_default_config(ps2TxDMA);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, false);
+  channel_config_set_dreq(&c, pio_get_dreq(PS2_PIO, PS2_SM, true));
+  dma_channel_configure(ps2TxDMA, &c, &PS2_PIO->txf[PS2_SM], ps2Tx,
+                        sizeof(ps2Tx), false);
+
+  ps2RxDMA = dma_claim_unused_channel(true);
+  c = dma_channel_get_default_config(ps2RxDMA);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+  channel_config_set_read_increment(&c, false);
+  channel_config_set_write_increment(&c, true);
+  channel_config_set_dreq(&c, pio_get_dreq(PS2_PIO, PS2_SM, false));
+  // Bytes are shifted in from the left, so they end up in the top byte
+  dma_channel_configure(ps2RxDMA, &c, ps2Rx,
+                        (io_rw_8 *)&PS2_PIO->rxf[PS2_SM] + 3, sizeof(ps2Rx),
+                        false);
+  resetPS2Engine();
+}
+// Queue up a frame, padding the command out to the longest possible reply.
+// The controller stops acknowledging once its reply is over, which ends the
+// frame early.
+void ps2_startTransfer(const uint8_t *out, uint8_t len) {
+  if (ps2Busy) { resetPS2Engine(); }
+  if (len > sizeof(ps2Tx)) { len = sizeof(ps2Tx); }
+  memcpy(ps2Tx, out, len);
+  memset(ps2Tx + len, PS2_PADDING, sizeof(ps2Tx) - len);
+  pio_sm_put(PS2_PIO, PS2_SM, sizeof(ps2Tx) - 1);
+  dma_channel_transfer_to_buffer_now(ps2RxDMA, ps2Rx, sizeof(ps2Rx));
+  dma_channel_transfer_from_buffer_now(ps2TxDMA, ps2Tx, sizeof(ps2Tx));
+  ps2Start = micros();
+  ps2Busy = true;
+}
+// Returns the number of bytes received by the last frame, or PS2_TRANSFER_BUSY
+// if it is still in progress.
+uint8_t ps2_pollTransfer(uint8_t **in) {
+  *in = ps2Rx;
+  if (!ps2Busy) { return 0; }
+  if (!pio_interrupt_get(PS2_PIO, 0)) {
+    if (micros() - ps2Start < PS2_FRAME_TIMEOUT) { return PS2_TRANSFER_BUSY; }
+    resetPS2Engine();
+    return 0;
+  }
+  // Let DMA collect the last byte before stopping it
+  while (!pio_sm_is_rx_fifo_empty(PS2_PIO, PS2_SM)) tight_loop_contents();
+  dma_channel_abort(ps2RxDMA);
+  dma_channel_abort(ps2TxDMA);
+  uint8_t received =
+      dma_channel_hw_addr(ps2RxDMA)->write_addr - (uintptr_t)ps2Rx;
+  // Throw away any padding that was queued up, then let the next frame start
+  pio_sm_clear_fifos(PS2_PIO, PS2_SM);
+  pio_interrupt_clear(PS2_PIO, 0);
+  ps2Busy = false;
+  return received;
+}
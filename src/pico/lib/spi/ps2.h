@@ -0,0 +1,10 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+// The longest frame the engine will clock out
+#define PS2_BUFFER_SIZE 32
+// Returned by ps2_pollTransfer while a frame is still being clocked
+#define PS2_TRANSFER_BUSY 0xFF
+void ps2_begin(void);
+void ps2_startTransfer(const uint8_t *out, uint8_t len);
+uint8_t ps2_pollTransfer(uint8_t **in);
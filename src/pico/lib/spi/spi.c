@@ -13,9 +13,10 @@
 #include "pins/pins.h"
 
 pio_spi_inst_t spi = {.pio = pio0, .sm = 0};
+bool spiLSBFirst;
 void spi_begin(uint32_t clock, bool cpol, bool cpha, bool lsbfirst) {
-  // LSBFIRST isnt supported here (also, we may just drop using this and only
-  // use PIO)
+  // PS2 controllers have their own PIO engine (spi/ps2.c), this is used for
+  // everything else
   // spi_init(spi0, clock);
   // spi_set_format(spi0, 8, cpol ? SPI_CPOL_1 : SPI_CPOL_0,
   //                cpha ? SPI_CPHA_1 : SPI_CPHA_0, SPI_MSB_FIRST);
@@ -30,22 +31,17 @@ void spi_begin(uint32_t clock, bool cpol, bool cpha, bool lsbfirst) {
       pio_add_program(spi.pio, cpha ? &spi_cpha1_program : &spi_cpha0_program);
   pio_spi_init(spi.pio, spi.sm, cpha_prog_offs,
                8, // 8 bits per SPI frame
-               clkdiv, cpha, cpol, PIN_SPI_SCK, PIN_SPI_MOSI, PIN_SPI_MISO);
-}
-uint8_t revbits2(uint8_t x) {
-  x = (((x & 0xaaU) >> 1) | ((x & 0x55U) << 1));
-  x = (((x & 0xccU) >> 2) | ((x & 0x33U) << 2));
-  x = (((x & 0xf0U) >> 4) | ((x & 0x0fU) << 4));
-  return x;
+               clkdiv, cpha, cpol, lsbfirst, PIN_SPI_SCK, PIN_SPI_MOSI,
+               PIN_SPI_MISO);
+  spiLSBFirst = lsbfirst;
 }
 uint8_t spi_transfer(uint8_t data) {
-  uint8_t read = data;
-  data = revbits2(data);
-  uint8_t resp;
-  pio_spi_write8_read8_blocking(&spi, &data, &resp, 1);
-  resp = revbits2(resp);
-  printf("0x%02x => 0x%02x\n", read, resp);
-  return resp;
+  // Replicate the byte across the whole word so it is justified correctly
+  // for either shift direction
+  pio_sm_put_blocking(spi.pio, spi.sm, data * 0x01010101u);
+  uint32_t resp = pio_sm_get_blocking(spi.pio, spi.sm);
+  // LSB first shifts in from the left, leaving the byte at the top
+  return spiLSBFirst ? resp >> 24 : resp;
 }
 void spi_high(void) {
   // CPOL = SCK inverted!
@@ -47,8 +47,12 @@ typedef struct {
   bool boot_mode;        // default = false (Report)
   uint8_t idle_rate;     // up to application to handle idle rate
   uint16_t report_desc_len;
+  // Reports are built straight into one IN buffer while the other holds the
+  // last report sent, so that unchanged reports can be dropped.
+  uint8_t epin_next;
+  uint8_t epin_len;
 
-  CFG_TUSB_MEM_ALIGN uint8_t epin_buf[CFG_TUD_VENDOR_EP_BUFSIZE];
+  CFG_TUSB_MEM_ALIGN uint8_t epin_buf[2][CFG_TUD_VENDOR_EP_BUFSIZE];
   CFG_TUSB_MEM_ALIGN uint8_t epout_buf[CFG_TUD_VENDOR_EP_BUFSIZE];
 } xinputd_interface_t;
 
@@ -63,6 +67,16 @@ static inline uint8_t get_index_by_itfnum(uint8_t itf_num) {
   return 0xFF;
 }
 
+static bool send_epin_buf(xinputd_interface_t *p_xinput, uint8_t len) {
+  uint8_t const rhport = 0;
+  uint8_t *buf = p_xinput->epin_buf[p_xinput->epin_next];
+  // claim endpoint
+  TU_VERIFY(usbd_edpt_claim(rhport, p_xinput->ep_in));
+  p_xinput->epin_len = len;
+  p_xinput->epin_next ^= 1;
+  return usbd_edpt_xfer(rhport, p_xinput->ep_in, buf, len);
+}
+
 //--------------------------------------------------------------------+
 // APPLICATION API
 //--------------------------------------------------------------------+
@@ -73,27 +87,42 @@ bool tud_xinput_n_ready(uint8_t itf) {
 
 bool tud_xinput_n_report(uint8_t itf, uint8_t report_id, void const *report,
                          uint8_t len) {
-  uint8_t const rhport = 0;
   xinputd_interface_t *p_xinput = &_xinputd_itf[itf];
-
-  // claim endpoint
-  TU_VERIFY(usbd_edpt_claim(rhport, p_xinput->ep_in));
+  uint8_t *buf = p_xinput->epin_buf[p_xinput->epin_next];
 
   // prepare data
   if (report_id) {
     len = tu_min8(len, CFG_TUD_VENDOR_EP_BUFSIZE - 1);
 
-    p_xinput->epin_buf[0] = report_id;
-    memcpy(p_xinput->epin_buf + 1, report, len);
+    buf[0] = report_id;
+    memcpy(buf + 1, report, len);
     len++;
   } else {
     // If report id = 0, skip ID field
     len = tu_min8(len, CFG_TUD_VENDOR_EP_BUFSIZE);
-    memcpy(p_xinput->epin_buf, report, len);
+    memcpy(buf, report, len);
   }
 
-  return usbd_edpt_xfer(TUD_OPT_RHPORT, p_xinput->ep_in, p_xinput->epin_buf,
-                        len);
+  return send_epin_buf(p_xinput, len);
+}
+
+uint8_t *tud_xinput_n_report_buffer(uint8_t itf) {
+  if (!tud_xinput_n_ready(itf)) return NULL;
+  xinputd_interface_t *p_xinput = &_xinputd_itf[itf];
+  return p_xinput->epin_buf[p_xinput->epin_next];
+}
+
+bool tud_xinput_n_report_submit(uint8_t itf, uint8_t len) {
+  xinputd_interface_t *p_xinput = &_xinputd_itf[itf];
+  uint8_t next = p_xinput->epin_next;
+  len = tu_min8(len, CFG_TUD_VENDOR_EP_BUFSIZE);
+  // The host already has this report
+  if (len == p_xinput->epin_len &&
+      memcmp(p_xinput->epin_buf[next], p_xinput->epin_buf[next ^ 1], len) ==
+          0) {
+    return true;
+  }
+  return send_epin_buf(p_xinput, len);
 }
 
 bool tud_xinput_n_boot_mode(uint8_t itf) { return _xinputd_itf[itf].boot_mode; }
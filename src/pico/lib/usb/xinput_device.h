@@ -47,6 +47,14 @@ bool tud_xinput_n_boot_mode(uint8_t itf);
 // Send report to host
 bool tud_xinput_n_report(uint8_t itf, uint8_t report_id, void const *report,
                          uint8_t len);
+
+// Get the buffer the next report should be built in, or NULL if the interface
+// is not ready
+uint8_t *tud_xinput_n_report_buffer(uint8_t itf);
+
+// Send the report built in the buffer from tud_xinput_n_report_buffer. Reports
+// that match the last one sent are dropped, and count as sent.
+bool tud_xinput_n_report_submit(uint8_t itf, uint8_t len);
 void xinputd_init(void);
 void xinputd_reset(uint8_t rhport);
 uint16_t xinputd_open(uint8_t rhport, tusb_desc_interface_t const *itf_desc,
@@ -3,8 +3,19 @@
 #include <hardware/timer.h>
 #include <pico/stdlib.h>
 #include <pico/time.h>
+#include <pico/multicore.h>
+#include <stdbool.h>
 uint32_t saved_irq;
 void cli() { saved_irq = save_and_disable_interrupts(); }
 void sei() { restore_interrupts(saved_irq); }
 void _delay_ms(uint32_t __ms) { sleep_ms(__ms); }
-void _delay_us(uint32_t __us) { sleep_us(__us); }
\ No newline at end of file
+void _delay_us(uint32_t __us) { sleep_us(__us); }
+bool inputsPaused;
+void pauseInputs(void) {
+  // Core 1 only takes part in lockouts once it is reading inputs
+  inputsPaused = multicore_lockout_victim_is_initialized(1);
+  if (inputsPaused) { multicore_lockout_start_blocking(); }
+}
+void resumeInputs(void) {
+  if (inputsPaused) { multicore_lockout_end_blocking(); }
+}
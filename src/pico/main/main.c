@@ -21,7 +21,9 @@
 #include "timer/timer.h"
 #include "util/util.h"
 #include <device/usbd_pvt.h>
+#include <hardware/structs/usb.h>
 #include <hardware/sync.h>
+#include <pico/multicore.h>
 #include <pico/unique_id.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -36,14 +38,25 @@ bool typeIsGuitar;
 bool typeIsDrum;
 uint8_t inputType;
 uint8_t pollRate;
+uint16_t sofLeadTime;
+volatile uint32_t lastSof = 0;
+volatile bool sofPending = false;
 
 CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t buf[64];
+bool isXInputInterface(uint16_t itf) {
+#ifdef MULTI_ADAPTOR
+  if (itf >= INTERFACE_ID_XInput_2 && itf <= INTERFACE_ID_XInput_4) {
+    return true;
+  }
+#endif
+  return itf == INTERFACE_ID_XInput;
+}
 bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage,
                                 tusb_control_request_t const *request) {
   if (request->bRequest == HID_REQ_GetReport &&
       (request->bmRequestType ==
        (REQDIR_DEVICETOHOST | REQTYPE_VENDOR | REQREC_INTERFACE)) &&
-      request->wIndex == INTERFACE_ID_XInput && request->wValue == 0x0000) {
+      isXInputInterface(request->wIndex) && request->wValue == 0x0000) {
 
     if (stage == CONTROL_STAGE_SETUP) {
       tud_control_xfer(rhport, request, capabilities1, sizeof(capabilities1));
@@ -77,7 +90,7 @@ bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage,
   } else if (request->bRequest == HID_REQ_GetReport &&
              (request->bmRequestType ==
               (REQDIR_DEVICETOHOST | REQTYPE_VENDOR | REQREC_INTERFACE)) &&
-             request->wIndex == INTERFACE_ID_XInput &&
+             isXInputInterface(request->wIndex) &&
              request->wValue == 0x0100) {
 
     if (stage == CONTROL_STAGE_SETUP) {
@@ -127,7 +140,7 @@ uint8_t const *tud_descriptor_device_cb(void) {
   return (uint8_t const *)&deviceDescriptor;
 }
 uint8_t const *tud_hid_descriptor_report_cb(uint8_t instance) {
-  if (fullDeviceType <= KEYBOARD_ROCK_BAND_GUITAR) {
+  if (fullDeviceType <= KEYBOARD_ROCK_BAND_DRUMS) {
     return kbd_report_descriptor;
   } else {
     return ps3_report_descriptor;
@@ -139,15 +152,16 @@ uint8_t const *tud_descriptor_configuration_cb(uint8_t index) {
   if (isGuitar(devt)) { devt = REAL_GUITAR_SUBTYPE; }
   if (isDrum(devt)) { devt = REAL_DRUM_SUBTYPE; }
   ConfigurationDescriptor.XInputReserved.subtype = devt;
-  if (devt <= KEYBOARD_ROCK_BAND_GUITAR) {
+  if (fullDeviceType <= KEYBOARD_ROCK_BAND_DRUMS) {
     ConfigurationDescriptor.HIDDescriptor.HIDReportLength =
         sizeof(kbd_report_descriptor);
   }
-  // TODO: if we ever implement this stuff, this needs to be implemented
-  // again.
-  // conf->XInputReserved2.subtype = XINPUT_ARCADE_PAD;
-  // conf->XInputReserved3.subtype = XINPUT_DANCE_PAD;
-  // conf->XInputReserved4.subtype = REAL_DRUM_SUBTYPE;
+#ifdef MULTI_ADAPTOR
+  // The rf controllers are expected to be the same type as this one
+  ConfigurationDescriptor.XInputReserved2.subtype = devt;
+  ConfigurationDescriptor.XInputReserved3.subtype = devt;
+  ConfigurationDescriptor.XInputReserved4.subtype = devt;
+#endif
   return (uint8_t *)&ConfigurationDescriptor;
 }
 static uint16_t serialNumber[9];
@@ -172,48 +186,171 @@ uint16_t const *tud_descriptor_string_cb(uint8_t index, uint16_t langid) {
   return NULL;
 }
 Controller_t controller;
-USB_Report_Data_t previousReport;
+#ifdef MULTI_ADAPTOR
+// The local inputs drive the first controller, and rf pipes 1 to 3 the rest
+#  define CONTROLLER_COUNT 4
+Controller_t rfControllers[CONTROLLER_COUNT - 1];
+Controller_t *const controllers[CONTROLLER_COUNT] = {
+    &controller, &rfControllers[0], &rfControllers[1], &rfControllers[2]};
+#else
+#  define CONTROLLER_COUNT 1
+Controller_t *const controllers[CONTROLLER_COUNT] = {&controller};
+#endif
+// Changes for each controller that have not made it into a report yet
+uint16_t controllerChanges[CONTROLLER_COUNT];
+bool localInputs;
 USB_Report_Data_t currentReport;
 uint8_t size;
+// Inputs are read on core 1, and published to core 0 via a seqlock. The
+// sequence number is odd while core 1 is writing a new snapshot, and core 0
+// retries its copy if the sequence number changed while it was reading.
+volatile uint32_t inputSequence = 0;
+Controller_t inputSnapshot;
+// Changes since the last snapshot that core 0 took. Core 1 only starts a fresh
+// set once core 0 has taken the latest snapshot, so no change is ever lost.
+uint16_t snapshotChanges = 0;
+volatile uint32_t takenSequence = 0;
+void publishInputs(Controller_t *src) {
+  if (!inputChanges) return;
+  inputSequence++;
+  __dmb();
+  if (takenSequence == inputSequence - 1) { snapshotChanges = 0; }
+  snapshotChanges |= inputChanges;
+  inputSnapshot = *src;
+  __dmb();
+  inputSequence++;
+  inputChanges = 0;
+}
+// Copy the latest snapshot, returning the parts that changed since the last
+// call
+uint16_t readInputs(Controller_t *dest) {
+  uint32_t seq;
+  uint16_t changes;
+  if (inputSequence == takenSequence) return 0;
+  do {
+    seq = inputSequence;
+    if (seq & 1) continue;
+    __dmb();
+    *dest = inputSnapshot;
+    changes = snapshotChanges;
+    __dmb();
+  } while ((seq & 1) || seq != inputSequence);
+  takenSequence = seq;
+  return changes;
+}
+void input_task(void) {
+  // Core 1 may be paused while core 0 is writing to flash
+  multicore_lockout_victim_init();
+  Controller_t local = {0};
+  while (1) {
+    tickInputs(&local);
+    tickLEDs(&local);
+    publishInputs(&local);
+  }
+}
+// Returns true once per frame, once we are within sofLeadTime us of the next
+// frame starting.
+bool sofReady(void) {
+  if (!sofPending || time_us_32() - lastSof < 1000 - sofLeadTime) return false;
+  sofPending = false;
+  return true;
+}
+// The controller that an rf packet belongs to, or CONTROLLER_COUNT if none
+uint8_t getRFController(void) {
+#ifdef MULTI_ADAPTOR
+  return rfPipe && rfPipe < CONTROLLER_COUNT ? rfPipe : CONTROLLER_COUNT;
+#else
+  return 0;
+#endif
+}
+// XInput reports are built straight into the endpoint buffer of each
+// controller. The controller that goes first rotates, so that no interface is
+// always queued last.
+bool sendXInputReports(void) {
+  static uint8_t first = 0;
+  bool sent = false;
+  for (uint8_t n = 0; n < CONTROLLER_COUNT; n++) {
+    uint8_t i = first + n;
+    if (i >= CONTROLLER_COUNT) i -= CONTROLLER_COUNT;
+    if (!controllerChanges[i]) continue;
+    uint8_t *data = tud_xinput_n_report_buffer(i);
+    if (!data) continue;
+    fillReport(data, &size, controllers[i]);
+    if (tud_xinput_n_report_submit(i, size)) {
+      controllerChanges[i] = 0;
+      sent = true;
+    }
+  }
+  if (++first == CONTROLLER_COUNT) first = 0;
+  return sent;
+}
 void hid_task(void) {
   static uint32_t start_ms = 0;
   if (isRF) {
-    tickRFInput((uint8_t *)&controller, sizeof(XInput_Data_t));
-  } else {
-    tickInputs(&controller);
-    tickLEDs(&controller);
+    Controller_t received;
+    // Several transmitters may have packets waiting, so read everything in the
+    // FIFO and route each packet by the pipe it arrived on
+    for (uint8_t n = 0; n < RF_RX_FIFO_SIZE &&
+                        tickRFInput((uint8_t *)&received, sizeof(XInput_Data_t));
+         n++) {
+      uint8_t i = getRFController();
+      if (i < CONTROLLER_COUNT) {
+        memcpy(controllers[i], &received, sizeof(XInput_Data_t));
+        controllerChanges[i] = CHANGED_ALL;
+      }
+    }
+  }
+  if (localInputs) {
     if (millis() - start_ms < pollRate) return;
+    if (sofLeadTime && !sofReady()) return;
+    controllerChanges[0] |= readInputs(&controller);
   }
-  fillReport(&currentReport, &size, &controller);
-  if (memcmp(&currentReport, &previousReport, size) != 0) {
-    uint8_t *data = (uint8_t *)&currentReport;
-    uint8_t rid = *data;
-    switch (rid) {
-    case REPORT_ID_XINPUT:
-      if (tud_xinput_n_ready(0)) {
-        tud_xinput_n_report(0, 0, data, size);
+  // Mouse reports are relative, so they are sent every poll regardless
+  if (fullDeviceType == MOUSE) { controllerChanges[0] = CHANGED_ALL; }
+  bool pending = reportPending;
+  for (uint8_t i = 0; i < CONTROLLER_COUNT; i++) {
+    if (controllerChanges[i]) pending = true;
+  }
+  if (pending) {
+#ifdef MULTI_ADAPTOR
+    if (sendXInputReports()) { start_ms = millis(); }
+#else
+    if (fullDeviceType <= XINPUT_ARCADE_PAD) {
+      if (sendXInputReports()) { start_ms = millis(); }
+    } else {
+      fillReport(&currentReport, &size, &controller);
+      uint8_t *data = (uint8_t *)&currentReport;
+      uint8_t rid = *data;
+      switch (rid) {
+      case REPORT_ID_GAMEPAD:
+        rid = 0;
+      case REPORT_ID_KBD:
+      case REPORT_ID_MOUSE:
+        data++;
+        size--;
+        if (tud_hid_n_ready(0)) {
+          tud_hid_n_report(0, rid, data, size);
+          start_ms = millis();
+          controllerChanges[0] = 0;
+        }
+        break;
+      case REPORT_ID_MIDI: {
+        // A report can hold several events, hand them over one by one and give
+        // back whatever does not fit in the midi fifo
+        uint8_t count = size ? (size - 1) / sizeof(MIDI_EventPacket_t) : 0;
+        uint8_t sent = 0;
+        data++;
+        while (sent < count && tud_midi_n_packet_write(0, data)) {
+          data += sizeof(MIDI_EventPacket_t);
+          sent++;
+        }
+        returnMIDIEvents(count - sent);
         start_ms = millis();
+        controllerChanges[0] = 0;
       }
-      break;
-#ifndef MULTI_ADAPTOR
-    case REPORT_ID_GAMEPAD:
-      rid = 0;
-    case REPORT_ID_KBD:
-    case REPORT_ID_MOUSE:
-      data++;
-      size--;
-      if (tud_hid_n_ready(0)) {
-        tud_hid_n_report(0, rid, data, size);
-        start_ms = millis();
       }
-      break;
-    case REPORT_ID_MIDI:
-      data++;
-      size--;
-      tud_midi_n_packet_write(0, data);
-      start_ms = millis();
-#endif
     }
+#endif
 
     // Remote wakeup
     if (tud_suspended()) {
@@ -230,6 +367,10 @@ void initialise(void) {
   fullDeviceType = fullDeviceType;
   deviceType = fullDeviceType;
   pollRate = config.main.pollRate;
+  sofLeadTime = config.sofLeadTime;
+  if (sofLeadTime > 1000) { sofLeadTime = 1000; }
+  // The usb controller only raises SOF interrupts when asked to
+  if (sofLeadTime) { usb_hw_set->inte = USB_INTS_DEV_SOF_BITS; }
   inputType = config.main.inputType;
   typeIsDrum = isDrum(fullDeviceType);
   typeIsGuitar = isGuitar(fullDeviceType);
@@ -241,13 +382,23 @@ void initialise(void) {
   }
   setupMicrosTimer();
   if (config.rf.rfInEnabled) {
-    initRF(false, config.rf.id, generate_crc32());
+    uint32_t rxid = generate_crc32();
+    initRF(false, config.rf.id, rxid);
+#ifdef MULTI_ADAPTOR
+    listenRFPipes(rxid, CONTROLLER_COUNT - 1);
+#endif
     isRF = true;
-  } else {
-    initInputs(&config);
   }
+#ifdef MULTI_ADAPTOR
+  // The first controller always comes from this board
+  localInputs = true;
+#else
+  localInputs = !isRF;
+#endif
+  if (localInputs) { initInputs(&config); }
   initReports(&config);
   initLEDs(&config);
+  if (localInputs) { multicore_launch_core1(input_task); }
 }
 int main() {
   initialise();
@@ -261,13 +412,17 @@ void writeToUSB(const void *const Buffer, uint8_t Length, uint8_t report,
   tud_control_xfer(report, request, (uint8_t *)Buffer + 1, Length - 1);
 }
 void stopReading(void) {}
+void xinputd_sof(uint8_t rhport) {
+  lastSof = time_us_32();
+  sofPending = true;
+}
 
 usbd_class_driver_t driver[] = {{.init = xinputd_init,
                                  .reset = xinputd_reset,
                                  .open = xinputd_open,
                                  .control_xfer_cb = tud_vendor_control_xfer_cb,
                                  .xfer_cb = xinputd_xfer_cb,
-                                 .sof = NULL}};
+                                 .sof = xinputd_sof}};
 usbd_class_driver_t const *usbd_app_driver_get_cb(uint8_t *driver_count) {
   *driver_count = 1;
   return driver;
@@ -27,7 +27,6 @@
 __attribute__((section(".rfrecv"))) uint32_t rftxID = 0xDEADBEEF;
 __attribute__((section(".rfrecv"))) uint32_t rfrxID = 0xDEADBEEF;
 Controller_t controller;
-Controller_t prevCtrl;
 long lastPoll = 0;
 int validAnalog = 0;
 uint8_t pollRate;
@@ -66,8 +65,7 @@ int main(void) {
       tickLEDs(&controller);
       // Since we receive data via acks, we need to make sure data is always
       // being sent, so we send data every 100ms regardless.
-      if (memcmp(&controller, &prevCtrl, sizeof(Controller_t)) != 0 ||
-          millis() - lastPoll > 100) {
+      if (inputChanges || millis() - lastPoll > 100) {
         lastPoll = millis();
 
         uint8_t data[12];
@@ -85,7 +83,7 @@ int main(void) {
             }
           }
         }
-        memcpy(&prevCtrl, &controller, sizeof(Controller_t));
+        inputChanges = 0;
         if (lastButtons != controller.buttons) {
           lastButtons = controller.buttons;
           lastChange = millis();
@@ -97,6 +97,8 @@ typedef struct {
   uint8_t note[XBOX_AXIS_COUNT + XBOX_BTN_COUNT];
   uint8_t channel[XBOX_AXIS_COUNT + XBOX_BTN_COUNT];
 } MidiConfig_t;
+// Velocity curve points, for raw drum velocities of 0, 32, 64 ... 256
+#define MIDI_CURVE_POINTS 9
 
 typedef struct {
   bool rfInEnabled;
@@ -122,6 +124,13 @@ typedef struct {
   bool combinedStrum;
 } DebounceConfig_t;
 
+typedef struct {
+  // DMP output rate (hz), up to 200
+  uint8_t rate;
+  // Pin wired to the INT line, or INVALID_PIN to poll the FIFO at the DMP rate
+  uint8_t intPin;
+} MPUConfig_t;
+
 typedef struct {
   MainConfig_t main;
   Pins_t pins;
@@ -133,6 +142,12 @@ typedef struct {
   uint8_t pinsSP;
   AxisScaleConfig_t axisScale;
   DebounceConfig_t debounce;
+  // How many microseconds before the start of the next USB frame a report
+  // should be sent. 0 sends reports as soon as they change.
+  uint16_t sofLeadTime;
+  MPUConfig_t mpu;
+  // MIDI velocity for drum hits, see MIDI_CURVE_POINTS
+  uint8_t midiVelocityCurve[MIDI_CURVE_POINTS];
 } Configuration_t;
 
 #pragma pack(pop)
\ No newline at end of file
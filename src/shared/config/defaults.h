@@ -1,7 +1,7 @@
 #pragma once
 #include "../leds/led_colours.h"
 #include "./defines.h"
-#define CONFIG_VERSION 15
+#define CONFIG_VERSION 18
 #define TILT_SENSOR NONE
 #define DEVICE_TYPE DIRECT
 #define OUTPUT_TYPE XINPUT_GUITAR_HERO_GUITAR
@@ -13,6 +13,8 @@
 #define TILT_SENSITIVITY 3000
 #define STRUM_DEBOUNCE 20
 #define BUTTON_DEBOUNCE 5
+#define SOF_LEAD_TIME 0
+#define MPU_RATE 200
 
 #define FRET_MODE LEDS_DISABLED
 #define COLOUR(col)                                                            \
@@ -67,6 +69,8 @@
   }
 #define FIRMWARE ARDWIINO_DEVICE_TYPE
 
+#define DEFAULT_MPU                                                            \
+  { MPU_RATE, INVALID_PIN }
 #define DEFAULT_CONFIG_MAIN                                                    \
   {                                                                            \
     DEVICE_TYPE, OUTPUT_TYPE, TILT_SENSOR, POLL_RATE, FRET_MODE,               \
@@ -82,6 +86,9 @@
   {                                                                            \
     {0}, {0}, { 0 }                                                            \
   }
+// Linear, matching the old raw velocity / 2
+#define DEFAULT_VELOCITY_CURVE                                                 \
+  { 0, 16, 32, 48, 64, 80, 96, 112, 127 }
 #define DEFAULT_AXIS_SCALES                                                    \
   {                                                                            \
     DEFAULT_AXIS_SCALE_TRIGGER, DEFAULT_AXIS_SCALE_TRIGGER,                    \
@@ -94,5 +101,6 @@
   {                                                                            \
     DEFAULT_CONFIG_MAIN, PINS, DEFAULT_THRESHOLDS, KEYS, LED_PINS,             \
         DEFAULT_MIDI, {false}, INVALID_PIN, DEFAULT_AXIS_SCALES,               \
-        DEFAULT_DEBOUNCE                                                       \
+        DEFAULT_DEBOUNCE, SOF_LEAD_TIME, DEFAULT_MPU,                          \
+        DEFAULT_VELOCITY_CURVE                                                 \
   }
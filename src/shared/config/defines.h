@@ -4,10 +4,13 @@
 #define REAL_GUITAR_SUBTYPE 7
 #define REAL_DRUM_SUBTYPE 8
 // Tilt detection
-enum TiltType { NO_TILT, MPU_6050, DIGITAL, ANALOGUE };
+// MPU_6050_RAW reads the accelerometer and gyro directly instead of using the
+// DMP
+enum TiltType { NO_TILT, MPU_6050, DIGITAL, ANALOGUE, MPU_6050_RAW };
 
 // Input types
-enum InputType { WII = 1, DIRECT, PS2 };
+// GH5_NECK reads the frets from a GH5 / GHWT neck, and everything else as DIRECT
+enum InputType { WII = 1, DIRECT, PS2, GH5_NECK };
 
 enum SubType {
   XINPUT_GAMEPAD = 1,
@@ -21,6 +21,9 @@ typedef struct {
   int16_t l_y;
   int16_t r_x;
   int16_t r_y;
+  // Analog button pressures, in PS3 report order. Left at 0 by inputs that
+  // only have digital buttons.
+  uint8_t pressures[12];
 } Controller_t;
 typedef struct {
   uint16_t buttons;
@@ -18,12 +18,85 @@ int triggerThreshold;
 bool mapJoyLeftDpad;
 bool mapStartSelectHome;
 bool mergedStrum;
+uint16_t inputChanges = 0;
 Pin_t pinData[XBOX_BTN_COUNT] = {};
+// Stages that tickInputs runs, in order. Only stages that the current config
+// needs are added, so that disabled features cost nothing per tick.
+#define MAX_TICK_STAGES 8
+typedef void (*TickStage_t)(Controller_t *controller);
+TickStage_t tickStages[MAX_TICK_STAGES];
+uint8_t tickStageCount = 0;
+// Indexes into pinData for the strum pins, which share debounce state when
+// strum is merged
+uint8_t strumUpIndex;
+uint8_t strumDownIndex;
+void tickButtons(Controller_t *controller) {
+  for (uint8_t i = 0; i < validPins; i++) {
+    Pin_t *pin = &pinData[i];
+    if (millis() - pin->lastMillis > pin->milliDeBounce) {
+      bool val = read_button_function(*pin);
+      if (val != (bit_check(controller->buttons, pin->offset))) {
+        pin->lastMillis = millis();
+        bit_write(val, controller->buttons, pin->offset);
+      }
+    }
+  }
+}
+void tickButtonsMergedStrum(Controller_t *controller) {
+  for (uint8_t i = 0; i < validPins; i++) {
+    Pin_t *pin = &pinData[i];
+    // Grab debounce data from the same button for both strum directions
+    Pin_t *pin2 = i == strumUpIndex ? &pinData[strumDownIndex] : pin;
+    if (millis() - pin2->lastMillis > pin2->milliDeBounce) {
+      bool val = read_button_function(*pin);
+      if (val != (bit_check(controller->buttons, pin->offset))) {
+        pin2->lastMillis = millis();
+        bit_write(val, controller->buttons, pin->offset);
+      }
+    }
+  }
+}
+void tickJoyDpad(Controller_t *controller) {
+  CHECK_JOY(l_x, XBOX_DPAD_LEFT, XBOX_DPAD_RIGHT);
+  CHECK_JOY(l_y, XBOX_DPAD_DOWN, XBOX_DPAD_UP);
+}
+void tickStartSelectHome(Controller_t *controller) {
+  if (bit_check(controller->buttons, XBOX_START) &&
+      bit_check(controller->buttons, XBOX_BACK)) {
+    bit_clear(controller->buttons, XBOX_START);
+    bit_clear(controller->buttons, XBOX_BACK);
+    bit_set(controller->buttons, XBOX_HOME);
+  }
+}
+void addTickStage(TickStage_t stage) { tickStages[tickStageCount++] = stage; }
+void initTickStages(void) {
+  tickStageCount = 0;
+  if (tick_function) { addTickStage(tick_function); }
+  addTickStage(tickDirectInput);
+  if (validPortGroups) { addTickStage(tickPortGroups); }
+  if (read_button_function) {
+    strumUpIndex = strumDownIndex = INVALID_PIN;
+    for (uint8_t i = 0; i < validPins; i++) {
+      if (pinData[i].offset == XBOX_DPAD_UP) strumUpIndex = i;
+      if (pinData[i].offset == XBOX_DPAD_DOWN) strumDownIndex = i;
+    }
+    if (mergedStrum && strumUpIndex != INVALID_PIN &&
+        strumDownIndex != INVALID_PIN) {
+      addTickStage(tickButtonsMergedStrum);
+    } else {
+      addTickStage(tickButtons);
+    }
+  }
+  if (mapJoyLeftDpad) { addTickStage(tickJoyDpad); }
+  if (mapStartSelectHome) { addTickStage(tickStartSelectHome); }
+  if (tick) { addTickStage(tick); }
+}
 void initInputs(Configuration_t *config) {
   mapJoyLeftDpad = config->main.mapLeftJoystickToDPad;
   mapStartSelectHome = config->main.mapStartSelectToHome;
   mergedStrum = typeIsGuitar && config->debounce.combinedStrum;
   setupADC();
+  tick_function = NULL;
   switch (config->main.inputType) {
   case WII:
     initWiiExtensions(config);
@@ -33,56 +106,39 @@ void initInputs(Configuration_t *config) {
   case DIRECT:
     read_button_function = digitalReadPin;
     break;
+  case GH5_NECK:
+    read_button_function = digitalReadPin;
+    tick_function = tickGH5Neck;
+    break;
   case PS2:
     initPS2CtrlInput(config);
-    read_button_function = readPS2Button;
+    // Buttons are decoded straight from the poll reply
+    read_button_function = NULL;
     tick_function = tickPS2CtrlInput;
     break;
   }
   if (config->main.inputType != PS2 && config->main.fretLEDMode == APA102) {
     spi_begin(F_CPU / 2, true, true, false);
   }
-  if (config->main.inputType == WII || config->main.tiltType == MPU_6050) {
+  if (config->main.inputType == WII || config->main.inputType == GH5_NECK ||
+      config->main.tiltType == MPU_6050 ||
+      config->main.tiltType == MPU_6050_RAW) {
     twi_init();
   }
+  if (config->main.inputType == GH5_NECK) { initGH5Neck(config); }
   initDirectInput(config);
   initGuitar(config);
   joyThreshold = config->axis.joyThreshold << 8;
   triggerThreshold = config->axis.triggerThreshold;
+  initTickStages();
 }
 void tickInputs(Controller_t *controller) {
-  if (tick_function) { tick_function(controller); }
-  tickDirectInput(controller);
-  Pin_t* pin;
-  Pin_t* pin2;
-  for (uint8_t i = 0; i < validPins; i++) {
-    pin = &pinData[i];
-    pin2 = &pinData[i];
-    // If strum is merged, then we want to grab debounce data from the same button for both
-    if (mergedStrum && i == XBOX_DPAD_UP) {
-      pin2 = &pinData[XBOX_DPAD_DOWN];
-    }
-    if (millis() - pin2->lastMillis > pin2->milliDeBounce) {
-      bool val = read_button_function(*pin);
-      if (val != (bit_check(controller->buttons, pin->offset))) {
-        pin2->lastMillis = millis();
-        bit_write(val, controller->buttons, pin->offset);
-      }
-    }
-  }
-  if (mapJoyLeftDpad) {
-    CHECK_JOY(l_x, XBOX_DPAD_LEFT, XBOX_DPAD_RIGHT);
-    CHECK_JOY(l_y, XBOX_DPAD_DOWN, XBOX_DPAD_UP);
-  }
-  if (mapStartSelectHome) {
-    if (bit_check(controller->buttons, XBOX_START) &&
-        bit_check(controller->buttons, XBOX_BACK)) {
-      bit_clear(controller->buttons, XBOX_START);
-      bit_clear(controller->buttons, XBOX_BACK);
-      bit_set(controller->buttons, XBOX_HOME);
-    }
-  }
-  tickGuitar(controller);
+  // Several stages rewrite the same button bits within a tick (joystick to
+  // dpad re-sets bits the button stage cleared), so buttons are compared once
+  // all stages have run instead.
+  uint16_t buttons = controller->buttons;
+  for (uint8_t i = 0; i < tickStageCount; i++) { tickStages[i](controller); }
+  if (controller->buttons != buttons) { inputChanges |= CHANGED_BUTTONS; }
 }
 uint8_t getVelocity(Controller_t *controller, uint8_t offset) {
   if (offset < XBOX_BTN_COUNT) {
@@ -9,6 +9,27 @@
   if (controller->joy > joyThreshold) {                            \
     bit_set(controller->buttons, pos);                                          \
   }
+// Parts of the controller that changed since the last report was sent. Input
+// stages set these as they write, so that the main loop can skip building a
+// report when nothing has changed.
+#define CHANGED_BUTTONS _BV(0)
+#define CHANGED_AXIS(axis) _BV(1 + (axis))
+#define CHANGED_lt CHANGED_AXIS(XBOX_LT)
+#define CHANGED_rt CHANGED_AXIS(XBOX_RT)
+#define CHANGED_l_x CHANGED_AXIS(XBOX_L_X)
+#define CHANGED_l_y CHANGED_AXIS(XBOX_L_Y)
+#define CHANGED_r_x CHANGED_AXIS(XBOX_R_X)
+#define CHANGED_r_y CHANGED_AXIS(XBOX_R_Y)
+#define CHANGED_DRUMS _BV(7)
+#define CHANGED_PRESSURES _BV(8)
+#define CHANGED_ALL 0x1FF
+// Write an axis on controller, marking it as changed if the value differs
+#define WRITE_AXIS(axis, value)                                                \
+  do {                                                                         \
+    int16_t last_ = controller->axis;                                          \
+    controller->axis = (value);                                                \
+    if (controller->axis != last_) { inputChanges |= CHANGED_##axis; }         \
+  } while (0)
 void findAnalogPin(void);
 void findDigitalPin(void);
 void stopSearching(void);
@@ -18,4 +39,6 @@ void setSP(bool sp);
 uint8_t getVelocity(Controller_t* controller, uint8_t offset);
 extern uint8_t detectedPin;
 extern int16_t analogueData[XBOX_AXIS_COUNT];
-extern Pin_t pinData[XBOX_BTN_COUNT];
\ No newline at end of file
+extern Pin_t pinData[XBOX_BTN_COUNT];
+extern bool mergedStrum;
+extern uint16_t inputChanges;
\ No newline at end of file
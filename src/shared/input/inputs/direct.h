@@ -4,9 +4,16 @@
 #include "guitar.h"
 #include "output/descriptors.h"
 #include "pins/pins.h"
+#include "timer/timer.h"
 #include "util/util.h"
+#include <stddef.h>
 #include <stdlib.h>
+#define MAX_PORT_GROUPS 8
 int validPins = 0;
+// Pins sampled via port groups are stored at the end of pinData
+uint8_t groupedPins = 0;
+PortGroup_t portGroups[MAX_PORT_GROUPS];
+uint8_t validPortGroups = 0;
 uint8_t detectedPin = 0xff;
 bool lookingForDigital = false;
 bool lookingForAnalog = false;
@@ -19,29 +26,122 @@ bool usingSPI;
 uint8_t spPin;
 uint8_t tiltType;
 uint8_t drumVelocity[8];
-AxisScale_t scales[6];
+// Work needed to turn an analog sample into a report value, resolved once in
+// initDirectInput so that tickDirectInput doesn't need to look at the config
+typedef struct {
+  const volatile int16_t *value;
+  // Offset into ControllerCombined_t, or the drumVelocity index for drums
+  uint8_t dest;
+  uint8_t axis;
+  bool trigger;
+  uint16_t changed;
+  int16_t offset;
+  int16_t multiplier;
+  // Scaled values in [deadLow, deadHigh) are replaced with deadValue
+  int16_t deadLow;
+  int16_t deadHigh;
+  int16_t deadValue;
+} AxisPlan_t;
+// Axes are stored first, followed by drum pads
+AxisPlan_t axisPlan[NUM_ANALOG_INPUTS];
+uint8_t axisPlans = 0;
+uint8_t drumPlans = 0;
 void reinitDirectInput(void) {
   if (spPin != INVALID_PIN) { pinMode(spPin, OUTPUT); }
-  for (int i = 0; i < validPins; i++) {
+  for (int i = 0; i < XBOX_BTN_COUNT; i++) {
+    if (i >= validPins && i < XBOX_BTN_COUNT - groupedPins) continue;
     Pin_t p = pinData[i];
     pinMode(p.pin,
             (p.eq || (p.analogOffset != INVALID_PIN)) ? INPUT : INPUT_PULLUP);
   }
 }
+// Add a pin to the port group for its port, returning false if it needs to be
+// read individually instead.
+bool addToPortGroup(Pin_t *pin) {
+  const volatile PortWord_t *port = pinPortRegister(*pin);
+  PortWord_t mask = pinPortMask(*pin);
+  PortGroup_t *group = NULL;
+  for (uint8_t i = 0; i < validPortGroups; i++) {
+    if (portGroups[i].port == port) {
+      group = &portGroups[i];
+      break;
+    }
+  }
+  if (!group) {
+    if (validPortGroups == MAX_PORT_GROUPS) return false;
+    group = &portGroups[validPortGroups++];
+    memset(group, 0, sizeof(PortGroup_t));
+    group->port = port;
+  }
+  group->mask |= mask;
+  if (pin->eq) { group->eq |= mask; }
+  bit_set(group->buttonMask, pin->offset);
+  return true;
+}
+void initAxisPlan(Configuration_t *config) {
+  AxisScale_t *scales = (AxisScale_t *)&config->axisScale;
+  axisPlans = drumPlans = 0;
+  for (uint8_t i = 0; i < validAnalog; i++) {
+    AnalogInfo_t *info = &joyData[i];
+    if (info->hasDigital) continue;
+    AxisScale_t *scale = &scales[info->offset];
+    AxisPlan_t *plan = &axisPlan[axisPlans++];
+    plan->value = &info->value;
+    plan->axis = info->offset;
+    plan->offset = scale->offset;
+    plan->multiplier = scale->multiplier;
+    plan->trigger = info->offset < 2;
+    plan->changed = CHANGED_AXIS(info->offset);
+    if (plan->trigger) {
+      plan->dest = offsetof(ControllerCombined_t, triggers) + info->offset;
+    } else {
+      plan->dest = offsetof(ControllerCombined_t, sticks) +
+                   (info->offset - 2) * sizeof(int16_t);
+    }
+    // Triggers center at -32767, sticks center at 0. Whammy works similar to
+    // a trigger, so we also count it here.
+    if (plan->trigger || (typeIsGuitar && info->offset == XBOX_WHAMMY)) {
+      plan->deadLow = INT16_MIN;
+      plan->deadValue = INT16_MIN;
+    } else {
+      int32_t low = 1 - (int32_t)scale->deadzone;
+      plan->deadLow = low > INT16_MAX ? INT16_MAX : low;
+      plan->deadValue = 0;
+    }
+    plan->deadHigh = scale->deadzone;
+  }
+  // Drum pads are tracked by the button they are bound to
+  for (uint8_t i = 0; i < validPins; i++) {
+    Pin_t *pin = &pinData[i];
+    if (pin->analogOffset == INVALID_PIN) continue;
+    AxisPlan_t *plan = &axisPlan[axisPlans + drumPlans++];
+    plan->value = &joyData[pin->analogOffset].value;
+    plan->dest = pin->offset - 8;
+  }
+}
 void initDirectInput(Configuration_t *config) {
   usingI2C =
-      (config->main.tiltType == MPU_6050 || config->main.inputType == WII);
+      (config->main.tiltType == MPU_6050 ||
+       config->main.tiltType == MPU_6050_RAW || config->main.inputType == WII ||
+       config->main.inputType == GH5_NECK);
   usingSPI =
       (config->main.fretLEDMode == APA102) || config->main.inputType == PS2;
   spPin = config->pinsSP;
   tiltType = config->main.tiltType;
   uint8_t *pins = (uint8_t *)&config->pins;
-  memcpy(scales, &config->axisScale, sizeof(scales));
   validPins = 0;
+  groupedPins = 0;
+  validPortGroups = 0;
+  // Merged strum shares debounce state between up and down, so it can't be
+  // sampled as part of a port group.
+  bool combinedStrum = typeIsGuitar && config->debounce.combinedStrum;
+  bool gh5Neck = config->main.inputType == GH5_NECK;
   setUpValidPins(config);
   if (config->pinsSP != INVALID_PIN) { pinMode(config->pinsSP, OUTPUT); }
   for (size_t i = 0; i < XBOX_BTN_COUNT; i++) {
-    if (config->main.inputType == DIRECT) {
+    if (config->main.inputType == DIRECT || gh5Neck) {
+      // The neck owns the frets, every other button is still read from pins
+      if (gh5Neck && isGH5Fret(i)) continue;
       if (pins[i] != INVALID_PIN) {
         bool is_fret = (i >= XBOX_A || i == XBOX_LB || i == XBOX_RB);
         Pin_t pin = setUpDigital(
@@ -55,8 +155,12 @@ void initDirectInput(Configuration_t *config) {
           setUpAnalogDigitalPin(&pin, pins[i], config->axis.drumThreshold << 3);
         } else {
           pinMode(pins[i], pin.eq ? INPUT : INPUT_PULLUP);
-          if (typeIsGuitar && (i == XBOX_DPAD_DOWN || i == XBOX_DPAD_UP)) {
-            pin.milliDeBounce = config->debounce.strum;
+          bool isStrum =
+              typeIsGuitar && (i == XBOX_DPAD_DOWN || i == XBOX_DPAD_UP);
+          if (isStrum) { pin.milliDeBounce = config->debounce.strum; }
+          if (!(isStrum && combinedStrum) && addToPortGroup(&pin)) {
+            pinData[XBOX_BTN_COUNT - ++groupedPins] = pin;
+            continue;
           }
         }
         pinData[validPins++] = pin;
@@ -70,6 +174,7 @@ void initDirectInput(Configuration_t *config) {
       pinData[validPins++] = pin;
     }
   }
+  initAxisPlan(config);
 }
 bool shouldSkipPin(uint8_t i) {
   // On the 328p, due to an inline LED, it isn't possible to check pin 13, also if debug is turned on then also dont allow uart pins.
@@ -140,6 +245,60 @@ void setSP(bool sp) {
   if (spPin != INVALID_PIN) { digitalWrite(spPin, sp); }
 }
 
+// Recalculate the buttons pressed for a port group after some of its pins
+// change, and lock the pins that changed for their debounce time. This only
+// happens on an edge, so it doesn't need to be fast.
+void updatePortGroupButtons(PortGroup_t *group, PortWord_t changed,
+                            uint32_t now) {
+  uint16_t buttons = 0;
+  for (uint8_t i = XBOX_BTN_COUNT - groupedPins; i < XBOX_BTN_COUNT; i++) {
+    Pin_t *pin = &pinData[i];
+    if (pinPortRegister(*pin) != group->port ||
+        !bit_check(group->buttonMask, pin->offset)) {
+      continue;
+    }
+    PortWord_t mask = pinPortMask(*pin);
+    if ((changed & mask) && pin->milliDeBounce) {
+      pin->lastMillis = now;
+      group->locked |= mask;
+    }
+    if (group->state & mask) { bit_set(buttons, pin->offset); }
+  }
+  group->buttons = buttons;
+}
+// Unlock the pins of a group whose debounce time has passed
+void unlockPortGroupPins(PortGroup_t *group, uint32_t now) {
+  for (uint8_t i = XBOX_BTN_COUNT - groupedPins; i < XBOX_BTN_COUNT; i++) {
+    Pin_t *pin = &pinData[i];
+    if (pinPortRegister(*pin) != group->port) continue;
+    PortWord_t mask = pinPortMask(*pin);
+    if ((group->locked & mask) &&
+        now - pin->lastMillis > pin->milliDeBounce) {
+      group->locked &= ~mask;
+    }
+  }
+}
+
+// Every pin is sampled each tick. A change is accepted on the first sample
+// that sees it, and the pin is then ignored for its debounce time so that
+// bounces are not reported, the same as pins that are read individually.
+void tickPortGroups(Controller_t *controller) {
+  if (!validPortGroups) return;
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < validPortGroups; i++) {
+    PortGroup_t *group = &portGroups[i];
+    if (group->locked) { unlockPortGroupPins(group, now); }
+    PortWord_t sample = ~(*group->port ^ group->eq) & group->mask;
+    PortWord_t delta = (sample ^ group->state) & ~group->locked;
+    if (delta) {
+      group->state ^= delta;
+      updatePortGroupButtons(group, delta, now);
+    }
+    controller->buttons =
+        (controller->buttons & ~group->buttonMask) | group->buttons;
+  }
+}
+
 void tickDirectInput(Controller_t *controller) {
   if (lookingForAnalog) {
     for (int i = 0; i < NUM_ANALOG_INPUTS; i++) {
@@ -165,36 +324,31 @@ void tickDirectInput(Controller_t *controller) {
     return;
   }
   tickAnalog();
-  AnalogInfo_t info;
-  ControllerCombined_t *combinedController = (ControllerCombined_t *)controller;
-  AxisScale_t scale;
-  for (int8_t i = 0; i < validAnalog; i++) {
-    info = joyData[i];
-    if (info.hasDigital) {
-      drumVelocity[info.offset - 8] = info.value;
+  uint8_t *out = (uint8_t *)controller;
+  AxisPlan_t *plan = axisPlan;
+  for (AxisPlan_t *end = plan + axisPlans; plan < end; plan++) {
+    int16_t raw = *plan->value;
+    analogueData[plan->axis] = raw;
+    int32_t val = ((int32_t)raw - plan->offset) * plan->multiplier;
+    val = val / 1024 + INT16_MIN;
+    if (val > INT16_MAX) val = INT16_MAX;
+    if (val < INT16_MIN) val = INT16_MIN;
+    if (val >= plan->deadLow && val < plan->deadHigh) val = plan->deadValue;
+    if (plan->trigger) {
+      uint8_t trigger = ((uint16_t)val) >> 8;
+      if (out[plan->dest] == trigger) continue;
+      out[plan->dest] = trigger;
     } else {
-      if (i == XBOX_TILT && typeIsGuitar && tiltType == DIGITAL) { continue; }
-      analogueData[info.offset] = info.value;
-      scale = scales[info.offset];
-      int32_t val = info.value;
-      val -= scale.offset;
-      val *= scale.multiplier;
-      val /= 1024;
-      val += INT16_MIN;
-      if (val > INT16_MAX) val = INT16_MAX;
-      if (val < INT16_MIN) val = INT16_MIN;
-      // Triggers center at -32767, sticks center at 0. Whammy works similar to
-      // a trigger, so we also count it here.
-      if (info.offset < 2 || (typeIsGuitar && info.offset == XBOX_WHAMMY)) {
-        if (val < scale.deadzone) { val = INT16_MIN; }
-      } else if (val < scale.deadzone && val > -scale.deadzone) {
-        val = 0;
-      }
-      if (info.offset >= 2) {
-        combinedController->sticks[info.offset - 2] = val;
-      } else {
-        combinedController->triggers[info.offset] = ((uint16_t)val) >> 8;
-      }
+      int16_t *stick = (int16_t *)(out + plan->dest);
+      if (*stick == val) continue;
+      *stick = val;
     }
+    inputChanges |= plan->changed;
+  }
+  for (AxisPlan_t *end = plan + drumPlans; plan < end; plan++) {
+    uint8_t velocity = *plan->value;
+    if (drumVelocity[plan->dest] == velocity) continue;
+    drumVelocity[plan->dest] = velocity;
+    inputChanges |= CHANGED_DRUMS;
   }
 }
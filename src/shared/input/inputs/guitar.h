@@ -2,10 +2,13 @@
 #include "controller/controller.h"
 #include "direct.h"
 #include "eeprom/eeprom.h"
+#include "fxpt_math/fxpt_math.h"
 #include "guitar.h"
 #include "i2c/i2c.h"
-#include "mpu6050/inv_mpu.h"
-#include "mpu6050/inv_mpu_dmp_motion_driver.h"
+#ifndef RAW_TILT
+#  include "mpu6050/inv_mpu.h"
+#  include "mpu6050/inv_mpu_dmp_motion_driver.h"
+#endif
 #include "mpu6050/mpu_math.h"
 #include "pins/pins.h"
 #include "timer/timer.h"
@@ -15,7 +18,8 @@
 #define GH5NECK_ADDR 0x0D
 #define GH5NECK_OK_PTR 0x11
 #define GH5NECK_BUTTONS_PTR 0x12
-// Extended GH5 slider with full multi-touch
+// Extended GH5 slider with full multi-touch. Its encoding isn't documented,
+// so it is read as part of the burst but not decoded.
 #define GH5NECK_SLIDER_NEW_PTR 0x15
 // Older style slider with WT-type detection, adjacent frets only
 #define GH5NECK_SLIDER_OLD_PTR 0x16
@@ -26,27 +30,50 @@
 #define QUAT_SENS 1073741824.f // 2^30
 // We want to scale values up by 128, as we are doing fixed point calculations.
 #define QUAT_SENS_FP 8388608L // 2^23
+// The DMP can't output faster than this (hz)
+#define MPU_MAX_RATE 200
+// Packets to read through when we fall behind, before giving up and resetting
+// the FIFO instead
+#define MPU_FIFO_DRAIN 4
+// Registers used when reading the MPU-6050 without the DMP
+#define MPU_ADDR 0x68
+#define MPU_SMPLRT_DIV 0x19
+#define MPU_CONFIG 0x1A
+#define MPU_GYRO_CONFIG 0x1B
+#define MPU_ACCEL_CONFIG 0x1C
+#define MPU_INT_PIN_CFG 0x37
+#define MPU_INT_ENABLE 0x38
+#define MPU_ACCEL_XOUT_H 0x3B
+#define MPU_PWR_MGMT_1 0x6B
+// Accelerometer, temperature and gyro, read in a single burst
+#define MPU_RAW_LEN 14
+// Converts gyro readings at +-2000dps to tilt (1/65536 of a turn) per us:
+// 1000000us * 360 * 16.4 LSB/dps / 65536
+#define MPU_GYRO_DIVISOR 90088L
+// Weight of the accelerometer in the complementary filter (Q15, ~0.02)
+#define MPU_ACCEL_WEIGHT 655
+// Cap on the time integrated in a single step (us)
+#define MPU_MAX_STEP 50000
+// Scale raw tilt the same way quaternionToEuler does
+#define MPU_TILT_MUL 5
+#ifndef RAW_TILT
 union u_quat q;
+#endif
 int16_t mpuTilt;
 AnalogInfo_t analog;
 volatile bool ready = false;
 uint8_t mpuOrientation;
+uint8_t mpuIntPin;
+unsigned long mpuInterval;
+unsigned long mpuLastRead;
+// Complementary filter state, in 1/65536 of a turn
+int16_t mpuAngle;
+unsigned long mpuLastSample;
+bool mpuFilterReady;
 uint8_t tiltPin;
 bool tiltInverted;
 AxisScale_t scale;
-void tickMPUTilt(Controller_t *controller) {
-  static short sensors;
-  static unsigned char fifoCount;
-  dmp_read_fifo(NULL, NULL, q._l, NULL, &sensors, &fifoCount);
-  if (sensors == INV_WXYZ_QUAT) {
-    q._f.w = q._l[0] >> 23;
-    q._f.x = q._l[1] >> 23;
-    q._f.y = q._l[2] >> 23;
-    q._f.z = q._l[3] >> 23;
-
-    quaternionToEuler(&q._f, &mpuTilt, mpuOrientation);
-    mpuTilt = tiltInverted ? -mpuTilt : mpuTilt;
-  }
+void writeMPUTilt(Controller_t *controller) {
   analogueData[XBOX_TILT] = mpuTilt;
   int32_t val = mpuTilt;
   val -= scale.offset;
@@ -56,32 +83,164 @@ void tickMPUTilt(Controller_t *controller) {
   if (val > INT16_MAX) val = INT16_MAX;
   if (val < INT16_MIN) val = INT16_MIN;
   // if (val < scale.deadzone) { val = INT16_MIN; }
-  controller->r_y = val;
+  WRITE_AXIS(r_y, val);
+}
+// The INT line is latched high once a packet is ready, and cleared by reading
+// the FIFO. Without it, only check the FIFO as often as the DMP fills it.
+bool mpuDataReady(void) {
+  if (mpuIntPin != INVALID_PIN) return digitalRead(mpuIntPin);
+  if (micros() - mpuLastRead < mpuInterval) return false;
+  mpuLastRead = micros();
+  return true;
+}
+#ifndef RAW_TILT
+void tickMPUTilt(Controller_t *controller) {
+  short sensors;
+  unsigned char fifoCount = 0;
+  bool fresh = false;
+  if (mpuDataReady()) {
+    // Only the newest packet matters, so read through anything that has
+    // backed up
+    long quat[4];
+    uint8_t reads = 0;
+    int8_t ret;
+    do {
+      ret = dmp_read_fifo(NULL, NULL, quat, NULL, &sensors, &fifoCount);
+      if (ret == 0 && sensors == INV_WXYZ_QUAT) {
+        memcpy(q._l, quat, sizeof(quat));
+        fresh = true;
+      }
+    } while (ret == 0 && fifoCount && ++reads < MPU_FIFO_DRAIN);
+    // Still behind, so throw away the stale packets. An overflow has already
+    // been reset by dmp_read_fifo.
+    if (ret == 0 && fifoCount) { mpu_reset_fifo(); }
+  }
+  if (fresh) {
+    q._f.w = q._l[0] >> 23;
+    q._f.x = q._l[1] >> 23;
+    q._f.y = q._l[2] >> 23;
+    q._f.z = q._l[3] >> 23;
+
+    quaternionToEuler(&q._f, &mpuTilt, mpuOrientation);
+    mpuTilt = tiltInverted ? -mpuTilt : mpuTilt;
+  }
+  writeMPUTilt(controller);
+}
+#endif
+void tickMPURawTilt(Controller_t *controller) {
+  uint8_t data[MPU_RAW_LEN];
+  if (mpuDataReady() &&
+      twi_readFromPointer(MPU_ADDR, MPU_ACCEL_XOUT_H, sizeof(data), data)) {
+    int16_t accel[3];
+    int16_t gyro[3];
+    for (uint8_t i = 0; i < 3; i++) {
+      accel[i] = (data[i * 2] << 8) | data[i * 2 + 1];
+      gyro[i] = (data[i * 2 + 8] << 8) | data[i * 2 + 9];
+    }
+    // Gravity moves in the plane around the rotation axis, and the gyro on
+    // that axis gives the rate of rotation
+    int16_t measured;
+    int16_t rate;
+    switch (mpuOrientation) {
+    case X:
+      measured = fxpt_atan2(accel[1], accel[2]);
+      rate = gyro[0];
+      break;
+    case Y:
+      measured = fxpt_atan2(-accel[0], accel[2]);
+      rate = gyro[1];
+      break;
+    default:
+      measured = fxpt_atan2(accel[0], accel[1]);
+      rate = gyro[2];
+      break;
+    }
+    unsigned long now = micros();
+    unsigned long step = now - mpuLastSample;
+    mpuLastSample = now;
+    if (step > MPU_MAX_STEP) step = MPU_MAX_STEP;
+    if (!mpuFilterReady) {
+      mpuAngle = measured;
+      mpuFilterReady = true;
+    } else {
+      // Integrate the gyro, and then pull towards the accelerometer to cancel
+      // out drift. Differences wrap, so this is fine across a half turn.
+      mpuAngle += (int32_t)rate * (int32_t)step / MPU_GYRO_DIVISOR;
+      mpuAngle += ((int32_t)(int16_t)(measured - mpuAngle) * MPU_ACCEL_WEIGHT) >>
+                  15;
+    }
+    int32_t tilt = mpuAngle;
+    if (tilt > INT16_MAX / MPU_TILT_MUL) tilt = INT16_MAX / MPU_TILT_MUL;
+    if (tilt < -INT16_MAX / MPU_TILT_MUL) tilt = -INT16_MAX / MPU_TILT_MUL;
+    tilt *= MPU_TILT_MUL;
+    mpuTilt = tiltInverted ? -tilt : tilt;
+  }
+  writeMPUTilt(controller);
 }
 void tickDigitalTilt(Controller_t *controller) {
-  controller->r_y = (!digitalRead(tiltPin)) * 32767;
+  WRITE_AXIS(r_y, (!digitalRead(tiltPin)) * 32767);
 }
 void (*tick)(Controller_t *controller) = NULL;
+#ifndef RAW_TILT
 // Would it be worth only doing this check once for speed?
 void initMPU6050(unsigned int rate) {
+  if (rate == 0 || rate > MPU_MAX_RATE) rate = MPU_MAX_RATE;
+  mpuInterval = 1000000 / rate;
   sei();
   mpu_init(NULL);
   mpu_set_sensors(INV_XYZ_GYRO | INV_XYZ_ACCEL);
   mpu_set_gyro_fsr(FSR);
   mpu_set_accel_fsr(2);
   mpu_configure_fifo(INV_XYZ_GYRO | INV_XYZ_ACCEL);
+  // Hold INT high until the FIFO is read, so a packet is never missed
+  mpu_set_int_latched(1);
   dmp_load_motion_driver_firmware();
   dmp_set_fifo_rate(rate);
   mpu_set_dmp_state(1);
   dmp_enable_feature(DMP_FEATURE_6X_LP_QUAT);
 }
+#endif
+// Reading the sensors directly skips uploading the DMP firmware
+void initMPU6050Raw(unsigned int rate) {
+  if (rate == 0 || rate > MPU_MAX_RATE) rate = MPU_MAX_RATE;
+  mpuInterval = 1000000 / rate;
+  mpuFilterReady = false;
+  // Wake up, clocked from the X gyro
+  twi_writeSingleToPointer(MPU_ADDR, MPU_PWR_MGMT_1, 0x01);
+  // Sample at 1khz through the 44hz low pass filter, divided down to rate
+  twi_writeSingleToPointer(MPU_ADDR, MPU_CONFIG, 0x03);
+  twi_writeSingleToPointer(MPU_ADDR, MPU_SMPLRT_DIV, 1000 / rate - 1);
+  // +-2000dps and +-2g
+  twi_writeSingleToPointer(MPU_ADDR, MPU_GYRO_CONFIG, 0x18);
+  twi_writeSingleToPointer(MPU_ADDR, MPU_ACCEL_CONFIG, 0x00);
+  // Latch data ready on INT until any register is read
+  twi_writeSingleToPointer(MPU_ADDR, MPU_INT_PIN_CFG, 0x30);
+  twi_writeSingleToPointer(MPU_ADDR, MPU_INT_ENABLE, 0x01);
+}
 void initGuitar(Configuration_t *config) {
+  tick = NULL;
   if (!typeIsGuitar) return;
-  if (config->main.tiltType == MPU_6050) {
+  uint8_t tiltType = config->main.tiltType;
+#ifdef RAW_TILT
+  // The DMP firmware is left out of raw tilt builds to save flash, so the
+  // MPU-6050 is always read directly
+  if (tiltType == MPU_6050) tiltType = MPU_6050_RAW;
+#endif
+  if (tiltType == MPU_6050 || tiltType == MPU_6050_RAW) {
     mpuOrientation = config->axis.mpu6050Orientation;
-    initMPU6050(30);
-    tick = tickMPUTilt;
-  } else if (config->main.tiltType == DIGITAL) {
+    mpuIntPin = config->mpu.intPin;
+    if (mpuIntPin != INVALID_PIN) { pinMode(mpuIntPin, INPUT); }
+#ifndef RAW_TILT
+    if (tiltType == MPU_6050) {
+      initMPU6050(config->mpu.rate);
+      tick = tickMPUTilt;
+    }
+#endif
+    if (tiltType == MPU_6050_RAW) {
+      initMPU6050Raw(config->mpu.rate);
+      tick = tickMPURawTilt;
+    }
+  } else if (tiltType == DIGITAL) {
     tiltPin = config->pins.r_y.pin;
     pinMode(tiltPin, INPUT_PULLUP);
     tick = tickDigitalTilt;
@@ -89,27 +248,89 @@ void initGuitar(Configuration_t *config) {
   scale = config->axisScale.r_y;
   tiltInverted = config->pins.r_y.inverted;
 }
-void tickGuitar(Controller_t *controller) {
-  if (!typeIsGuitar) return;
-  Guitar_t *g = (Guitar_t *)controller;
-  int32_t whammy = g->whammy;
-  if (whammy > 0xFFFF) { whammy = 0xFFFF; }
-  if (whammy < 0) { whammy = 0; }
-  g->whammy = whammy;
-  if (tick == NULL) return;
-  tick(controller);
+// The neck registers are read in a single burst, starting at GH5NECK_OK_PTR
+#define GH5NECK_BURST_LEN (GH5NECK_SLIDER_OLD_PTR - GH5NECK_OK_PTR + 1)
+// Every failed read adds GH5NECK_ERROR_COST to the error counter, and every
+// good read removes one. The bus is slowed down once it passes the limit.
+#define GH5NECK_ERROR_COST 4
+#define GH5NECK_ERROR_LIMIT 32
+// Frets in the order that the neck reports them
+const uint8_t gh5Frets[5] = {XBOX_A, XBOX_B, XBOX_Y, XBOX_X, XBOX_LB};
+bool isGH5Fret(uint8_t button) {
+  for (uint8_t i = 0; i < sizeof(gh5Frets); i++) {
+    if (gh5Frets[i] == button) return true;
+  }
+  return false;
+}
+uint8_t gh5Speed = TWI_SPEED_DEFAULT;
+uint8_t gh5Errors = 0;
+// Frets currently touched on the slider, one bit per fret, green first
+uint8_t gh5Slider = 0;
+// The old style slider reports a single value, and can only detect one fret
+// or two adjacent frets. The values match the World Tour guitar's touch bar,
+// as documented on wiibrew: 0x0F for nothing, 0x04 green, 0x07 green + red,
+// 0x0A red, 0x0C-0x0D red + yellow, 0x12-0x13 yellow, 0x14-0x15 yellow + blue,
+// 0x17-0x18 blue, 0x1A blue + orange and 0x1F orange.
+uint8_t decodeGH5OldSlider(uint8_t value) {
+  value &= 0x1f;
+  if (value == 0x0F) return 0;
+  if (value < 0x04) return 0;
+  if (value < 0x06) return 0b00001;
+  if (value < 0x09) return 0b00011;
+  if (value < 0x0C) return 0b00010;
+  if (value < 0x10) return 0b00110;
+  if (value < 0x14) return 0b00100;
+  if (value < 0x17) return 0b01100;
+  if (value < 0x1A) return 0b01000;
+  if (value < 0x1F) return 0b11000;
+  return 0b10000;
+}
+bool readGH5Neck(uint8_t *data) {
+  return twi_readFromPointer(GH5NECK_ADDR, GH5NECK_OK_PTR, GH5NECK_BURST_LEN,
+                             data);
+}
+void initGH5Neck(Configuration_t *config) {
+  // Find the fastest speed where reading the neck twice gives the same result.
+  // The MPU-6050 shares the bus, and it only supports fast mode
+  uint8_t check[GH5NECK_BURST_LEN];
+  uint8_t validate[GH5NECK_BURST_LEN];
+  gh5Speed = (config->main.tiltType == MPU_6050 ||
+              config->main.tiltType == MPU_6050_RAW)
+                 ? TWI_SPEED_DEFAULT
+                 : 0;
+  for (; gh5Speed < TWI_SPEED_DEFAULT; gh5Speed++) {
+    twi_setSpeed(gh5Speed);
+    if (readGH5Neck(check) && readGH5Neck(validate) && check[0] &&
+        memcmp(check, validate, sizeof(check)) == 0) {
+      break;
+    }
+  }
+  twi_setSpeed(gh5Speed);
+  gh5Errors = 0;
 }
-
-// TODO: this is all we need for grabbing data from a gh5 neck. We should test
-// this, do we actually need to run it at 100khz, or does our i2c implementation
-// work better somehow
 void tickGH5Neck(Controller_t *controller) {
-  uint8_t ok;
-  twi_readFromPointer(GH5NECK_ADDR, GH5NECK_OK_PTR, 1, &ok);
-  if (ok) {
-    uint8_t buttons;
-    twi_readFromPointer(GH5NECK_ADDR, GH5NECK_BUTTONS_PTR, 1, &buttons);
-    uint8_t slider;
-    twi_readFromPointer(GH5NECK_ADDR, GH5NECK_SLIDER_NEW_PTR, 1, &slider);
+  uint8_t data[GH5NECK_BURST_LEN];
+  uint8_t frets = 0;
+  if (!readGH5Neck(data)) {
+    // Keep the frets from the last good read, so a single failed read doesn't
+    // let go of every held fret
+    gh5Errors += GH5NECK_ERROR_COST;
+    if (gh5Errors > GH5NECK_ERROR_LIMIT) {
+      gh5Errors = 0;
+      if (gh5Speed < TWI_SPEED_COUNT - 1) { twi_setSpeed(++gh5Speed); }
+    }
+    return;
+  }
+  if (gh5Errors) gh5Errors--;
+  gh5Slider = 0;
+  if (data[0]) {
+    frets = data[GH5NECK_BUTTONS_PTR - GH5NECK_OK_PTR];
+    gh5Slider =
+        decodeGH5OldSlider(data[GH5NECK_SLIDER_OLD_PTR - GH5NECK_OK_PTR]);
   }
-}
\ No newline at end of file
+  // Touching the slider counts as holding the fret, so tapping works
+  frets |= gh5Slider;
+  for (uint8_t i = 0; i < sizeof(gh5Frets); i++) {
+    bit_write(bit_check(frets, i), controller->buttons, gh5Frets[i]);
+  }
+}
@@ -14,19 +14,26 @@
 #include <stdint.h>
 #include <stdio.h>
 #ifndef __AVR__
+#  include "spi/ps2.h"
 #endif
 // TODO: this seems like a much nicer implementation to copy
 // https://github.com/RandomInsano/pscontroller-rs/blob/master/src/lib.rs
 /** \brief Command Inter-Byte Delay (us)
  *
- * Commands are several bytes long. This is the time to wait between two
- * consecutive bytes.
- *
- * This should actually be done by watching the \a Acknowledge line, but we are
- * ignoring it at the moment.
+ * Commands are several bytes long. After each byte, the controller pulses the
+ * \a Acknowledge line once it is ready for the next byte. This is the longest
+ * we will wait for that pulse, which also covers the last byte of a reply (as
+ * it is never acknowledged) and controllers that don't drive the line.
  */
 #define INTER_CMD_BYTE_DELAY 15
 
+/** \brief Acknowledge pulse timeout (us)
+ *
+ * Once the \a Acknowledge line has gone low, the longest time to wait for it
+ * to be released again.
+ */
+#define ACK_RELEASE_TIMEOUT 10
+
 /** \brief Command timeout (ms)
  *
  * Commands are sent to the controller repeatedly, until they succeed or time
@@ -43,6 +50,21 @@
  */
 #define COMMAND_RETRY_INTERVAL 10
 
+/** \brief Detection back-off (ms)
+ *
+ * Time to wait before trying to detect a controller again, doubling after
+ * every failure up to the maximum.
+ */
+#define DETECT_BACKOFF_MIN 10
+#define DETECT_BACKOFF_MAX 320
+
+/** \brief Wake up polls
+ *
+ * Number of disposable polls sent to a newly detected controller to let it
+ * know we are here, 1ms apart.
+ */
+#define WAKE_POLLS 5
+
 /** \brief Attention Delay
  *
  * Time between attention being issued to the controller and the first clock
@@ -218,6 +240,11 @@ static const uint8_t guitarHeroButtonBindings[] = {
     [XBOX_B] = GH_RED,
     [XBOX_X] = GH_BLUE,
     [XBOX_Y] = GH_YELLOW};
+// Where each button pressure ends up in a PS3 report
+static const uint8_t ps3PressureBindings[] = {
+    PSAB_PAD_UP, PSAB_PAD_RIGHT, PSAB_PAD_DOWN, PSAB_PAD_LEFT,
+    PSAB_L2,     PSAB_R2,        PSAB_L1,       PSAB_R1,
+    PSAB_TRIANGLE, PSAB_CIRCLE,  PSAB_CROSS,    PSAB_SQUARE};
 uint16_t lastButtons;
 uint8_t ps2CtrlType = PSX_NO_DEVICE;
 
@@ -266,9 +293,9 @@ static inline bool isConfigReply(const uint8_t *status) {
  */
 #define BUFFER_SIZE 32
 
+#ifdef __AVR__
 Pin_t attention;
-Pin_t command;
-Pin_t clock;
+Pin_t acknowledge;
 void noAttention(void) {
   spi_high();
   digitalWritePin(attention, true);
@@ -279,11 +306,23 @@ void signalAttention(void) {
   spi_low();
   _delay_us(ATTN_DELAY);
 }
+// Wait for the controller to acknowledge a byte, falling back to a fixed delay
+// if it doesn't.
+void waitForAcknowledge(void) {
+  unsigned long start = micros();
+  while (!digitalReadPin(acknowledge)) {
+    if (micros() - start >= INTER_CMD_BYTE_DELAY) return;
+  }
+  start = micros();
+  while (digitalReadPin(acknowledge)) {
+    if (micros() - start >= ACK_RELEASE_TIMEOUT) return;
+  }
+}
 void shiftDataInOut(const uint8_t *out, uint8_t *in, const uint8_t len) {
   for (uint8_t i = 0; i < len; ++i) {
     uint8_t resp = spi_transfer(out != NULL ? out[i] : 0x5A);
     if (in != NULL) { in[i] = resp; }
-    _delay_us(INTER_CMD_BYTE_DELAY); // Very important!
+    waitForAcknowledge(); // Very important!
   }
 }
 uint8_t *autoShiftData(const uint8_t *out, const uint8_t len) {
@@ -319,58 +358,232 @@ uint8_t *autoShiftData(const uint8_t *out, const uint8_t len) {
   noAttention();
   return ret;
 }
-bool sendCommand(const uint8_t *buf, uint8_t len) {
-  bool ret = false;
-
-  unsigned long start = millis();
-  uint8_t cnt = 0;
-  do {
-    uint8_t *in = autoShiftData(buf, len);
-
-    /* We can't know if we have successfully enabled analog mode until
-     * we get out of config mode, so let's just be happy if we get a few
-     * consecutive valid replies
-     */
-    if (in != NULL) {
-      ++cnt;
-      if (buf == commandEnterConfig) {
-        ret = isConfigReply(in);
-      } else if (buf == commandExitConfig) {
-        ret = !isConfigReply(in);
+#else
+// The PIO engine clocks whole frames, so just make sure the reply is complete
+uint8_t *checkReply(uint8_t *in, uint8_t received) {
+  if (received < 3 || !isValidReply(in)) { return NULL; }
+  if (received < (in[1] & 0x0F) * 2 + 3) { return NULL; }
+  return in;
+}
+uint8_t *autoShiftData(const uint8_t *out, const uint8_t len) {
+  uint8_t *in;
+  uint8_t received;
+  ps2_startTransfer(out, len);
+  while ((received = ps2_pollTransfer(&in)) == PS2_TRANSFER_BUSY) {}
+  return checkReply(in, received);
+}
+#endif
+// Controllers are detected and configured by a state machine that sends at
+// most one command per tick, so that a missing controller never holds up the
+// main loop.
+enum PS2InitState_t {
+  PS2_DETECT,
+  PS2_WAKE,
+  PS2_ENTER_CONFIG,
+  PS2_SET_MODE,
+  PS2_SET_PRESSURES,
+  PS2_EXIT_CONFIG,
+  PS2_READY
+};
+enum PS2CommandResult_t {
+  PS2_COMMAND_PENDING,
+  PS2_COMMAND_DONE,
+  PS2_COMMAND_FAILED
+};
+uint8_t ps2InitState = PS2_DETECT;
+unsigned long ps2StepTime = 0;
+unsigned long ps2StepDelay = 0;
+unsigned long ps2Backoff = DETECT_BACKOFF_MIN;
+unsigned long ps2CommandStart;
+uint8_t ps2Replies;
+// What we learnt about the last controller, keyed by the reply ID it gave when
+// it was detected, so that plugging it back in can skip what it doesn't
+// support.
+uint8_t ps2KnownID = 0;
+uint8_t ps2ConfiguredID = 0;
+bool ps2HasConfig;
+bool ps2HasPressures;
+void ps2Wait(unsigned long ms) {
+  ps2StepTime = millis();
+  ps2StepDelay = ms;
+}
+// Nothing is plugged in, so try again later, waiting longer each time.
+void ps2RetryLater(void) {
+  ps2InitState = PS2_DETECT;
+  ps2CtrlType = PSX_NO_DEVICE;
+  ps2Wait(ps2Backoff);
+  if (ps2Backoff < DETECT_BACKOFF_MAX) ps2Backoff <<= 1;
+}
+void ps2NextCommand(uint8_t state) {
+  ps2InitState = state;
+  ps2Replies = 0;
+  ps2CommandStart = millis();
+}
+void finishPS2Init(void) {
+  ps2Backoff = DETECT_BACKOFF_MIN;
+  ps2InitState = PS2_READY;
+#ifndef __AVR__
+  ps2_startTransfer(commandPollInput, sizeof(commandPollInput));
+#endif
+}
+// Send a command once. Commands are retried every COMMAND_RETRY_INTERVAL until
+// they succeed or COMMAND_TIMEOUT runs out.
+uint8_t stepCommand(const uint8_t *buf, uint8_t len) {
+  uint8_t *in = autoShiftData(buf, len);
+  bool done = false;
+  /* We can't know if we have successfully enabled analog mode until
+   * we get out of config mode, so let's just be happy if we get a few
+   * consecutive valid replies
+   */
+  if (in != NULL) {
+    ++ps2Replies;
+    if (buf == commandEnterConfig) {
+      done = isConfigReply(in);
+    } else if (buf == commandExitConfig) {
+      done = !isConfigReply(in);
+    } else {
+      done = ps2Replies >= 3;
+    }
+  }
+  if (done) return PS2_COMMAND_DONE;
+  if (millis() - ps2CommandStart > COMMAND_TIMEOUT) return PS2_COMMAND_FAILED;
+  ps2Wait(COMMAND_RETRY_INTERVAL);
+  return PS2_COMMAND_PENDING;
+}
+void tickPS2CtrlInit(void) {
+  if (millis() - ps2StepTime < ps2StepDelay) return;
+  switch (ps2InitState) {
+  case PS2_DETECT: {
+    uint8_t *in = autoShiftData(commandPollInput, sizeof(commandPollInput));
+    if (in == NULL) {
+      ps2RetryLater();
+      break;
+    }
+    if (ps2ConfiguredID != ps2KnownID && in[1] == ps2ConfiguredID) {
+      // The last controller is back, and it is still configured
+      finishPS2Init();
+    } else if (in[1] == ps2KnownID && !isDigitalReply(in)) {
+      // The last controller is back, so only send what it supports. DualShock
+      // 2s start up in digital mode too, so digital replies always get the
+      // full negotiation.
+      if (ps2HasConfig) {
+        ps2NextCommand(PS2_ENTER_CONFIG);
       } else {
-        ret = cnt >= 3;
+        finishPS2Init();
       }
+    } else {
+      ps2KnownID = ps2ConfiguredID = in[1];
+      ps2HasConfig = ps2HasPressures = true;
+      ps2Replies = 0;
+      ps2InitState = PS2_WAKE;
+      ps2Wait(1);
     }
-
-    if (!ret) { _delay_ms(COMMAND_RETRY_INTERVAL); }
-  } while (!ret && millis() - start <= COMMAND_TIMEOUT);
-
-  return ret;
+    break;
+  }
+  case PS2_WAKE:
+    // Some disposable readings to let the controller know we are here
+    autoShiftData(commandPollInput, sizeof(commandPollInput));
+    if (++ps2Replies < WAKE_POLLS) {
+      ps2Wait(1);
+      break;
+    }
+    ps2NextCommand(PS2_ENTER_CONFIG);
+    break;
+  case PS2_ENTER_CONFIG:
+    switch (stepCommand(commandEnterConfig, sizeof(commandEnterConfig))) {
+    case PS2_COMMAND_DONE:
+      ps2NextCommand(PS2_SET_MODE);
+      break;
+    case PS2_COMMAND_FAILED:
+      // Dualshock one controllers don't have config mode
+      ps2HasConfig = false;
+      finishPS2Init();
+      break;
+    }
+    break;
+  case PS2_SET_MODE:
+    // Enable analog sticks
+    if (stepCommand(commandSetMode, sizeof(commandSetMode)) !=
+        PS2_COMMAND_PENDING) {
+      ps2NextCommand(ps2HasPressures ? PS2_SET_PRESSURES : PS2_EXIT_CONFIG);
+    }
+    break;
+  case PS2_SET_PRESSURES:
+    // Enable analog buttons
+    switch (stepCommand(commandSetPressures, sizeof(commandSetPressures))) {
+    case PS2_COMMAND_DONE:
+      ps2NextCommand(PS2_EXIT_CONFIG);
+      break;
+    case PS2_COMMAND_FAILED:
+      ps2HasPressures = false;
+      ps2NextCommand(PS2_EXIT_CONFIG);
+      break;
+    }
+    break;
+  case PS2_EXIT_CONFIG:
+    switch (stepCommand(commandExitConfig, sizeof(commandExitConfig))) {
+    case PS2_COMMAND_DONE:
+      finishPS2Init();
+      break;
+    case PS2_COMMAND_FAILED:
+      ps2RetryLater();
+      break;
+    }
+    break;
+  }
 }
 uint16_t buttonWord;
-bool read(Controller_t *controller) {
+// Map every button across in a single pass over the button word, debouncing
+// only the ones that changed.
+void writePS2Buttons(Controller_t *controller) {
+  const uint8_t *bindings = dualShockButtonBindings;
+  if (ps2CtrlType == PSX_GUITAR_HERO_CONTROLLER) {
+    bindings = guitarHeroButtonBindings;
+  } else if (ps2CtrlType == PSX_MOUSE) {
+    bindings = mouseButtonBindings;
+  }
+  uint16_t buttons = 0;
+  for (uint8_t i = 0; i < XBOX_BTN_COUNT; i++) {
+    uint8_t btn = bindings[i];
+    if (btn != INVALID && bit_check(buttonWord, btn)) { bit_set(buttons, i); }
+  }
+  uint16_t changed = buttons ^ controller->buttons;
+  unsigned long now = millis();
+  for (uint8_t i = 0; changed; i++, changed >>= 1) {
+    if (!(changed & 1)) continue;
+    // If strum is merged, then we want to grab debounce data from the same
+    // button for both
+    Pin_t *pin =
+        &pinData[mergedStrum && i == XBOX_DPAD_UP ? XBOX_DPAD_DOWN : i];
+    if (now - pin->lastMillis > pin->milliDeBounce) {
+      pin->lastMillis = now;
+      bit_write(bit_check(buttons, i), controller->buttons, i);
+    }
+  }
+}
+bool processReply(Controller_t *controller, uint8_t *in) {
   bool ret = false;
-  uint8_t *in = autoShiftData(commandPollInput, sizeof(commandPollInput));
-
   if (in != NULL) {
     if (isConfigReply(in)) {
       // We're stuck in config mode, try to get out
-      sendCommand(commandExitConfig, sizeof(commandExitConfig));
+      ps2NextCommand(PS2_EXIT_CONFIG);
     } else {
+      // Remember how the controller replies once configured
+      ps2ConfiguredID = in[1];
       // We surely have buttons
       buttonWord = ~(((uint16_t)in[4] << 8) | in[3]);
+      uint8_t pressures[sizeof(controller->pressures)] = {0};
 
       if (isFlightStickReply(in)) { ps2CtrlType = PSX_ANALOG; }
       if (isNegconReply(in)) {
         ps2CtrlType = PSX_NEGCON;
-        controller->l_x = (in[5] - 128) << 8;
+        WRITE_AXIS(l_x, (in[5] - 128) << 8);
         // These buttons are only analog, map them to digital
-        bit_write(in[6] > NEGCON_I_II_BUTTON_THRESHOLD, controller->buttons,
-                  XBOX_X);
-        bit_write(in[7] > NEGCON_I_II_BUTTON_THRESHOLD, controller->buttons,
-                  XBOX_Y);
-        bit_write(in[8] > NEGCON_L_BUTTON_THRESHOLD, controller->buttons,
-                  XBOX_LB);
+        bit_write(in[6] > NEGCON_I_II_BUTTON_THRESHOLD, buttonWord,
+                  PSB_SQUARE);
+        bit_write(in[7] > NEGCON_I_II_BUTTON_THRESHOLD, buttonWord,
+                  PSB_TRIANGLE);
+        bit_write(in[8] > NEGCON_L_BUTTON_THRESHOLD, buttonWord, PSB_L1);
       }
       if (isJogconReply(in)) {
         ps2CtrlType = PSX_JOGCON;
@@ -387,91 +600,100 @@ bool read(Controller_t *controller) {
          * We'll want to cap the movement halfway in each
          * direction, for ease of use/implementation.
          */
-        controller->l_x = in[5];
+        int16_t wheel;
         if (in[6] < 0x80) {
           // CW up to half
-          controller->l_x = in[5] < 0x80 ? in[5] : (0x80 - 1);
+          wheel = in[5] < 0x80 ? in[5] : (0x80 - 1);
         } else {
           // CCW down to half
-          controller->l_x = in[5] > 0x80 ? in[5] : (0x80 + 1);
+          wheel = in[5] > 0x80 ? in[5] : (0x80 + 1);
         }
 
         // Bring to the usual 0-255 range
-        controller->l_x += 0x80;
+        WRITE_AXIS(l_x, wheel + 0x80);
       }
       if (isMouseReply(in)) {
         ps2CtrlType = PSX_MOUSE;
-        controller->l_x = (in[5] - 128) << 8;
-        controller->l_y = -(in[6] - 127) << 8;
+        WRITE_AXIS(l_x, (in[5] - 128) << 8);
+        WRITE_AXIS(l_y, -(in[6] - 127) << 8);
       }
       if (isDualShockReply(in) || isFlightStickReply(in)) {
-        controller->r_x = (in[5] - 128) << 8;
-        controller->r_y = -(in[6] - 127) << 8;
-        controller->l_x = (in[7] - 128) << 8;
-        controller->l_y = -(in[8] - 127) << 8;
         if (typeIsGuitar) {
           ps2CtrlType = PSX_GUITAR_HERO_CONTROLLER;
-          controller->l_x = 0;
-          controller->l_y = 0;
-          controller->r_x = (in[8] - 128) << 8;
-          controller->r_y = (!!bit_check(buttonWord, GH_STAR_POWER)) * 32767;
+          WRITE_AXIS(l_x, 0);
+          WRITE_AXIS(l_y, 0);
+          WRITE_AXIS(r_x, (in[8] - 128) << 8);
+          WRITE_AXIS(r_y, (!!bit_check(buttonWord, GH_STAR_POWER)) * 32767);
+        } else {
+          WRITE_AXIS(r_x, (in[5] - 128) << 8);
+          WRITE_AXIS(r_y, -(in[6] - 127) << 8);
+          WRITE_AXIS(l_x, (in[7] - 128) << 8);
+          WRITE_AXIS(l_y, -(in[8] - 127) << 8);
         }
         if (isDualShock2Reply(in)) {
-          controller->lt = in[PSAB_L2 + 9];
-          controller->rt = in[PSAB_R2 + 9];
+          const uint8_t *analog = in + 9;
+          WRITE_AXIS(lt, analog[PSAB_L2]);
+          WRITE_AXIS(rt, analog[PSAB_R2]);
+          for (uint8_t i = 0; i < sizeof(ps3PressureBindings); i++) {
+            pressures[i] = analog[ps3PressureBindings[i]];
+          }
           ps2CtrlType = PSX_DUALSHOCK_2_CONTROLLER;
         } else if (!isFlightStickReply(in)) {
           ps2CtrlType = PSX_DUALSHOCK_1_CONTROLLER;
         }
       }
+      if (memcmp(controller->pressures, pressures, sizeof(pressures))) {
+        memcpy(controller->pressures, pressures, sizeof(pressures));
+        inputChanges |= CHANGED_PRESSURES;
+      }
+      writePS2Buttons(controller);
     }
     ret = true;
   }
 
   return ret;
 }
-
-bool begin(Controller_t *controller) {
-  // Some disposable readings to let the controller know we are here
-  for (uint8_t i = 0; i < 5; ++i) {
-    read(controller);
-    _delay_ms(1);
-  }
-  return read(controller);
+bool read(Controller_t *controller) {
+  return processReply(
+      controller, autoShiftData(commandPollInput, sizeof(commandPollInput)));
 }
 
 void initPS2CtrlInput(Configuration_t *config) {
+#ifdef __AVR__
   spi_begin(100000, true, true, true);
   attention = setUpDigital(config, PIN_PS2_ATT, 0, false, true);
   pinMode(PIN_PS2_ATT, OUTPUT);
+  // Acknowledge is open collector and active low
+  acknowledge = setUpDigital(config, PIN_PS2_ACK, 0, false, false);
+  pinMode(PIN_PS2_ACK, INPUT_PULLUP);
   noAttention();
+#else
+  ps2_begin();
+#endif
+  ps2CtrlType = PSX_NO_DEVICE;
+  ps2InitState = PS2_DETECT;
+  ps2Backoff = DETECT_BACKOFF_MIN;
+  ps2StepDelay = 0;
 }
 void tickPS2CtrlInput(Controller_t *controller) {
-  if (ps2CtrlType == PSX_NO_DEVICE) {
-    if (!begin(controller)) { return; }
-    sendCommand(commandEnterConfig, sizeof(commandEnterConfig));
-    if (true) {
-      // Dualshock one controllers don't have config mode
-      // Enable analog sticks
-      sendCommand(commandSetMode, sizeof(commandSetMode));
-      // Enable analog buttons
-      sendCommand(commandSetPressures, sizeof(commandSetPressures));
-      sendCommand(commandExitConfig, sizeof(commandExitConfig));
-    } else {
-      ps2CtrlType = PSX_DUALSHOCK_1_CONTROLLER;
-    }
+  if (ps2InitState != PS2_READY) {
+    tickPS2CtrlInit();
+    return;
   }
-  if (!read(controller)) { ps2CtrlType = PSX_NO_DEVICE; }
-}
-
-bool readPS2Button(Pin_t pin) {
-  const uint8_t *buttons = dualShockButtonBindings;
-  if (ps2CtrlType == PSX_GUITAR_HERO_CONTROLLER) {
-    buttons = guitarHeroButtonBindings;
-  } else if (ps2CtrlType == PSX_MOUSE) {
-    buttons = mouseButtonBindings;
+#ifdef __AVR__
+  bool ok = read(controller);
+#else
+  // Collect the last poll, and then queue up the next one
+  uint8_t *in;
+  uint8_t received = ps2_pollTransfer(&in);
+  if (received == PS2_TRANSFER_BUSY) { return; }
+  bool ok = processReply(controller, checkReply(in, received));
+  if (ok && ps2InitState == PS2_READY) {
+    ps2_startTransfer(commandPollInput, sizeof(commandPollInput));
+  }
+#endif
+  if (!ok) {
+    ps2CtrlType = PSX_NO_DEVICE;
+    ps2InitState = PS2_DETECT;
   }
-  uint8_t btn = buttons[pin.offset];
-  if (btn == INVALID) { return false; }
-  return !!bit_check(buttonWord, btn);
-}
\ No newline at end of file
+}
@@ -13,6 +13,20 @@
 #include <stdlib.h>
 #include <string.h>
 #define I2C_ADDR 0x52
+// Every failed read adds WII_ERROR_COST to the error counter, and every good
+// read removes one. Once the counter passes WII_ERROR_LIMIT the bus is slowed
+// down, so this falls back once more than ~1 in 5 reads fail.
+#define WII_ERROR_COST 4
+#define WII_ERROR_LIMIT 32
+// Amount of times the id is read when testing a bus speed
+#define WII_SPEED_TEST_READS 4
+// Time to wait before retrying detection (us), doubling after every failure
+#define WII_BACKOFF_MIN 10000
+#define WII_BACKOFF_MAX 320000
+// Attempts at reading the same data twice when checking for high res mode
+#define WII_HIGHRES_RETRIES 10
+// Reads that have to fail in a row before the extension is treated as unplugged
+#define WII_LOST_READS 4
 void tickWiiExtInput(Controller_t *controller);
 // uint8_t wiiButtonBindings[16] = {
 //     INVALID_PIN,  INVALID_PIN,    XBOX_START,     XBOX_HOME,
@@ -27,6 +41,17 @@ uint16_t wiiExtensionID = WII_NO_EXTENSION;
 uint16_t buttons;
 uint8_t bytes = 6;
 bool mapNunchukAccelToRightJoy;
+// The fastest bus speed we are allowed to try, and the speed that was picked
+// for the extension with the id wiiSpeedID.
+uint8_t wiiMaxSpeed = 0;
+uint8_t wiiSpeed = TWI_SPEED_DEFAULT;
+uint16_t wiiSpeedID = WII_NO_EXTENSION;
+uint8_t wiiErrors = 0;
+uint8_t wiiFailedReads = 0;
+// The last frame that was decoded. Held buttons and axes mostly return the
+// same bytes, and in that case the controller is already up to date.
+uint8_t lastWiiFrame[8];
+bool lastWiiFrameValid = false;
 void (*readFunction)(Controller_t *, uint8_t *) = NULL;
 
 bool verifyData(const uint8_t *dataIn, uint8_t dataSize) {
@@ -52,33 +77,38 @@ uint16_t readExtID(void) {
   return data[0] << 8 | data[5];
 }
 void readDrumExt(Controller_t *controller, uint8_t *data) {
-  controller->l_x = (data[0] - 0x20) << 10;
-  controller->l_y = (data[1] - 0x20) << 10;
+  WRITE_AXIS(l_x, (data[0] - 0x20) << 10);
+  WRITE_AXIS(l_y, (data[1] - 0x20) << 10);
   // Mask out unused bits
   buttons = ~(data[4] | (data[5] << 8)) & 0xfeff;
   if (fullDeviceType >= MIDI_GAMEPAD && bit_check(data[3], 1)) {
     uint8_t vel = (7 - (data[3] >> 5)) << 5;
     uint8_t which = (data[2] & 0b01111100) >> 1;
+    uint8_t pad = INVALID_PIN;
     switch (which) {
     case 0x1B:
-      drumVelocity[XBOX_RB - 8] = vel;
+      pad = XBOX_RB;
       break;
     case 0x19:
-      drumVelocity[XBOX_B - 8] = vel;
+      pad = XBOX_B;
       break;
     case 0x11:
-      drumVelocity[XBOX_X - 8] = vel;
+      pad = XBOX_X;
       break;
     case 0x0F:
-      drumVelocity[XBOX_Y - 8] = vel;
+      pad = XBOX_Y;
       break;
     case 0x1E:
-      drumVelocity[XBOX_LB - 8] = vel;
+      pad = XBOX_LB;
       break;
     case 0x12:
-      drumVelocity[XBOX_A - 8] = vel;
+      pad = XBOX_A;
       break;
     }
+    if (pad != INVALID_PIN && drumVelocity[pad - 8] != vel) {
+      drumVelocity[pad - 8] = vel;
+      inputChanges |= CHANGED_DRUMS;
+    }
   }
   // The standard extension bindings are almost correct, but x and y are
   // swapped, so swap them
@@ -86,47 +116,48 @@ void readDrumExt(Controller_t *controller, uint8_t *data) {
   bit_write(!bit_check(data[5], 5), buttons, wiiButtonBindings[XBOX_Y]);
 }
 void readGuitarExt(Controller_t *controller, uint8_t *data) {
-  controller->l_x = ((data[0] & 0x3f) - 32) << 10;
-  controller->l_y = ((data[1] & 0x3f) - 32) << 10;
+  WRITE_AXIS(l_x, ((data[0] & 0x3f) - 32) << 10);
+  WRITE_AXIS(l_y, ((data[1] & 0x3f) - 32) << 10);
   // Whammy is weird, it ranges from 0 - 12. multiply by 2.5 to get from 0 - 36,
   // clamp, and then shift to 0 - 65535
-  controller->r_x = ((data[3] & 0x1f) - 14);
-  if (controller->r_x < 0) { controller->r_x = 0; }
-  controller->r_x = (controller->r_x << 1) + controller->r_x;
-  if (controller->r_x > 31) { controller->r_x = 31; }
-  controller->r_x -= 16;
-  controller->r_x <<= 11;
+  int16_t whammy = ((data[3] & 0x1f) - 14);
+  if (whammy < 0) { whammy = 0; }
+  whammy = (whammy << 1) + whammy;
+  if (whammy > 31) { whammy = 31; }
+  whammy -= 16;
+  WRITE_AXIS(r_x, whammy << 11);
 
   buttons = ~(data[4] | data[5] << 8);
 }
 void readClassicExtHighRes(Controller_t *controller, uint8_t *data) {
-  controller->l_x = (data[0] - 0x80) << 8;
-  controller->l_y = (data[2] - 0x80) << 8;
-  controller->r_x = (data[1] - 0x80) << 8;
-  controller->r_y = (data[3] - 0x80) << 8;
-  controller->lt = data[4];
-  controller->rt = data[5];
+  WRITE_AXIS(l_x, (data[0] - 0x80) << 8);
+  WRITE_AXIS(l_y, (data[2] - 0x80) << 8);
+  WRITE_AXIS(r_x, (data[1] - 0x80) << 8);
+  WRITE_AXIS(r_y, (data[3] - 0x80) << 8);
+  WRITE_AXIS(lt, data[4]);
+  WRITE_AXIS(rt, data[5]);
   buttons = ~(data[6] | (data[7] << 8));
 }
 void readClassicExt(Controller_t *controller, uint8_t *data) {
-  controller->l_x = (data[0] & 0x3f) - 32;
-  controller->l_y = (data[1] & 0x3f) - 32;
-  controller->r_x =
-      (((data[0] & 0xc0) >> 3) | ((data[1] & 0xc0) >> 5) | (data[2] >> 7)) - 16;
-  controller->r_y = (data[2] & 0x1f) - 16;
-  controller->lt = ((data[3] >> 5) | ((data[2] & 0x60) >> 2));
-  controller->rt = data[3] & 0x1f;
+  WRITE_AXIS(l_x, (data[0] & 0x3f) - 32);
+  WRITE_AXIS(l_y, (data[1] & 0x3f) - 32);
+  WRITE_AXIS(r_x, (((data[0] & 0xc0) >> 3) | ((data[1] & 0xc0) >> 5) |
+                   (data[2] >> 7)) -
+                      16);
+  WRITE_AXIS(r_y, (data[2] & 0x1f) - 16);
+  WRITE_AXIS(lt, ((data[3] >> 5) | ((data[2] & 0x60) >> 2)));
+  WRITE_AXIS(rt, data[3] & 0x1f);
   buttons = ~(data[4] | data[5] << 8);
 }
 void readNunchukExt(Controller_t *controller, uint8_t *data) {
-  controller->l_x = (data[0] - 0x80) << 8;
-  controller->l_y = (data[1] - 0x80) << 8;
+  WRITE_AXIS(l_x, (data[0] - 0x80) << 8);
+  WRITE_AXIS(l_y, (data[1] - 0x80) << 8);
   if (mapNunchukAccelToRightJoy) {
     uint16_t accX = ((data[2] << 2) | ((data[5] & 0xC0) >> 6)) - 511;
     uint16_t accY = ((data[3] << 2) | ((data[5] & 0x30) >> 4)) - 511;
     uint16_t accZ = ((data[4] << 2) | ((data[5] & 0xC) >> 2)) - 511;
-    controller->r_x = fxpt_atan2(accX, accZ);
-    controller->r_y = fxpt_atan2(accY, accZ);
+    WRITE_AXIS(r_x, fxpt_atan2(accX, accZ));
+    WRITE_AXIS(r_y, fxpt_atan2(accY, accZ));
   }
   buttons = 0;
   bit_write(!bit_check(data[5], 0), buttons, wiiButtonBindings[XBOX_A]);
@@ -136,87 +167,154 @@ void readDJExt(Controller_t *controller, uint8_t *data) {
   uint8_t rtt =
       (data[2] & 0x80) >> 7 | (data[1] & 0xC0) >> 5 | (data[0] & 0xC0) >> 3;
 
-  controller->l_x = ((data[0] & 0x3F) - 0x20) << 10;
-  controller->l_y = ((data[1] & 0x3F) - 0x20) << 10;
-  controller->r_x =
-      (data[4] & 1) ? 32 + (0x1F - (data[3] & 0x1F)) : 32 - (data[3] & 0x1F);
-  controller->r_y = (data[2] & 1) ? 32 + (0x1F - rtt) : 32 - rtt;
-  controller->lt = (data[3] & 0xE0) >> 5 | (data[2] & 0x60) >> 2;
-  controller->rt = (data[2] & 0x1E) >> 1;
+  WRITE_AXIS(l_x, ((data[0] & 0x3F) - 0x20) << 10);
+  WRITE_AXIS(l_y, ((data[1] & 0x3F) - 0x20) << 10);
+  WRITE_AXIS(r_x, (data[4] & 1) ? 32 + (0x1F - (data[3] & 0x1F))
+                                 : 32 - (data[3] & 0x1F));
+  WRITE_AXIS(r_y, (data[2] & 1) ? 32 + (0x1F - rtt) : 32 - rtt);
+  WRITE_AXIS(lt, (data[3] & 0xE0) >> 5 | (data[2] & 0x60) >> 2);
+  WRITE_AXIS(rt, (data[2] & 0x1E) >> 1);
   buttons = ~(data[4] << 8 | data[5]) & 0x63CD;
 }
 void readUDrawExt(Controller_t *controller, uint8_t *data) {
-  controller->l_x = ((data[2] & 0x0f) << 8) | data[0];
-  controller->l_y = ((data[2] & 0xf0) << 4) | data[1];
-  controller->rt = data[3];
+  WRITE_AXIS(l_x, ((data[2] & 0x0f) << 8) | data[0]);
+  WRITE_AXIS(l_y, ((data[2] & 0xf0) << 4) | data[1]);
+  WRITE_AXIS(rt, data[3]);
   buttons = 0;
   bit_write(bit_check(data[5], 0), buttons, wiiButtonBindings[XBOX_A]);
   bit_write(bit_check(data[5], 1), buttons, wiiButtonBindings[XBOX_B]);
   bit_write(!bit_check(data[5], 2), buttons, wiiButtonBindings[XBOX_X]);
 }
 void readDrawsomeExt(Controller_t *controller, uint8_t *data) {
-  controller->l_x = data[0] | data[1] << 8;
-  controller->l_y = data[2] | data[3] << 8;
-  controller->rt = data[4] | (data[5] & 0x0f) << 8;
+  WRITE_AXIS(l_x, data[0] | data[1] << 8);
+  WRITE_AXIS(l_y, data[2] | data[3] << 8);
+  WRITE_AXIS(rt, data[4] | (data[5] & 0x0f) << 8);
   // controller->status = data[5]>>4;
 }
 void readTataconExt(Controller_t *controller, uint8_t *data) {
   buttons = ~(data[4] << 8 | data[5]);
 }
-void initWiiExt(void) {
-  wiiExtensionID = readExtID();
-  if (wiiExtensionID == WII_NOT_INITIALISED) {
-    // Send packets needed to initialise a controller
-    twi_writeSingleToPointer(I2C_ADDR, 0xF0, 0x55);
-    _delay_us(10);
-    twi_writeSingleToPointer(I2C_ADDR, 0xFB, 0x00);
-    _delay_us(10);
-    wiiExtensionID = readExtID();
-    _delay_us(10);
+void countWiiError(void) {
+  wiiErrors += WII_ERROR_COST;
+  if (wiiErrors > WII_ERROR_LIMIT) {
+    wiiErrors = 0;
+    if (wiiSpeed < TWI_SPEED_COUNT - 1) { twi_setSpeed(++wiiSpeed); }
   }
-  if (wiiExtensionID == WII_UBISOFT_DRAWSOME_TABLET) {
-    twi_writeSingleToPointer(I2C_ADDR, 0xFB, 0x01);
-    _delay_us(10);
-    twi_writeSingleToPointer(I2C_ADDR, 0xF0, 0x55);
-    _delay_us(10);
-  }
-  if (wiiExtensionID == WII_CLASSIC_CONTROLLER ||
-      wiiExtensionID == WII_CLASSIC_CONTROLLER_PRO) {
-    // Enable high-res mode
-    twi_writeSingleToPointer(I2C_ADDR, 0xFE, 0x03);
-    _delay_us(10);
-    // Some controllers support high res mode, some dont. Some require it, some
-    // dont. To mitigate this issue, we can check if the high res specific bytes
-    // are zeroed. However this isnt enough. If a byte is corrupted during
-    // transit than it may be triggered. Reading twice will allow us to confirm
-    // that nothing was corrupted,
-    uint8_t check[8];
-    uint8_t validate[8];
-    while (true) {
-      twi_readFromPointerSlow(I2C_ADDR, 0, sizeof(check), check);
-      _delay_us(200);
-      twi_readFromPointerSlow(I2C_ADDR, 0, sizeof(validate), validate);
-      if (memcmp(check, validate, sizeof(validate)) == 0) {
-        bool highRes = (check[0x06] || check[0x07]);
-        if (highRes) {
-          readFunction = readClassicExtHighRes;
-          bytes = 8;
-        } else {
-          readFunction = readClassicExt;
-          bytes = 6;
-        }
-        break;
-      }
-      _delay_us(200);
+}
+// Extensions are initialised by a state machine that performs one step per
+// tick, so that a missing or flaky extension never holds up the main loop.
+enum WiiInitState_t {
+  WII_DETECT,
+  WII_INIT_1,
+  WII_INIT_2,
+  WII_REDETECT,
+  WII_CONFIGURE,
+  WII_HIGHRES_CHECK,
+  WII_HIGHRES_VALIDATE,
+  WII_SPEED_TEST,
+  WII_READY
+};
+uint8_t wiiInitState = WII_DETECT;
+unsigned long wiiStepTime = 0;
+unsigned long wiiStepDelay = 0;
+unsigned long wiiBackoff = WII_BACKOFF_MIN;
+uint8_t wiiRetries;
+uint8_t wiiCheck[8];
+void wiiWait(unsigned long us) {
+  wiiStepTime = micros();
+  wiiStepDelay = us;
+}
+// Nothing usable is plugged in, so try again later, waiting longer each time.
+void wiiRetryLater(void) {
+  wiiInitState = WII_DETECT;
+  wiiWait(wiiBackoff);
+  if (wiiBackoff < WII_BACKOFF_MAX) wiiBackoff <<= 1;
+}
+void resetWiiInputs(Controller_t *controller) {
+  lastWiiFrameValid = false;
+  buttons = 0;
+  WRITE_AXIS(l_x, 0);
+  WRITE_AXIS(l_y, 0);
+  // Whammy rests at the bottom of its range
+  WRITE_AXIS(r_x, typeIsGuitar ? INT16_MIN : 0);
+  WRITE_AXIS(r_y, 0);
+  WRITE_AXIS(lt, 0);
+  WRITE_AXIS(rt, 0);
+  for (uint8_t i = 0; i < sizeof(drumVelocity); i++) {
+    if (drumVelocity[i]) {
+      drumVelocity[i] = 0;
+      inputChanges |= CHANGED_DRUMS;
     }
   }
+}
+void wiiReady(void) {
+  twi_setSpeed(wiiSpeed);
+  wiiBackoff = WII_BACKOFF_MIN;
+  wiiFailedReads = 0;
+  lastWiiFrameValid = false;
+  wiiInitState = WII_READY;
+}
+// Keep using the current speed for this extension
+void settleWiiSpeed(void) {
+  wiiSpeedID = wiiExtensionID;
+  wiiErrors = 0;
+  wiiReady();
+}
+// Start testing a bus speed. The default speed is used without testing, as
+// every extension supports it.
+void tryWiiSpeed(uint8_t speed) {
+  wiiSpeed = speed;
+  if (wiiSpeed >= TWI_SPEED_DEFAULT) {
+    settleWiiSpeed();
+    return;
+  }
+  twi_setSpeed(wiiSpeed);
+  wiiRetries = 0;
+  wiiInitState = WII_SPEED_TEST;
+  wiiWait(10);
+}
+// Reads the id once per step. Every read at a speed has to return the same
+// valid id, otherwise the next slower speed is tried.
+void tickWiiSpeedTest(void) {
+  uint8_t id[6];
+  bool ok = twi_readFromPointerSlow(I2C_ADDR, 0xFA, sizeof(id), id);
+  if (ok && !wiiRetries) {
+    ok = verifyData(id, sizeof(id)) && (id[0] << 8 | id[5]) == wiiExtensionID;
+    memcpy(wiiCheck, id, sizeof(id));
+  } else if (ok) {
+    ok = memcmp(wiiCheck, id, sizeof(id)) == 0;
+  }
+  if (!ok) {
+    tryWiiSpeed(wiiSpeed + 1);
+  } else if (++wiiRetries == WII_SPEED_TEST_READS) {
+    settleWiiSpeed();
+  } else {
+    wiiWait(10);
+  }
+}
+void finishWiiInit(void) {
+  // Only negotiate when a different extension is plugged in, or the last one
+  // was unplugged, otherwise keep using the speed we settled on last time.
+  if (wiiExtensionID != wiiSpeedID) {
+    tryWiiSpeed(wiiMaxSpeed);
+  } else {
+    wiiReady();
+  }
+}
+void configureWiiExt(void) {
+  bytes = 6;
   switch (wiiExtensionID) {
   case WII_GUITAR_HERO_GUITAR_CONTROLLER:
     readFunction = readGuitarExt;
     break;
   case WII_CLASSIC_CONTROLLER:
   case WII_CLASSIC_CONTROLLER_PRO:
-    break;
+    // Enable high-res mode, and then work out if it was actually enabled
+    twi_writeSingleToPointer(I2C_ADDR, 0xFE, 0x03);
+    wiiRetries = 0;
+    wiiInitState = WII_HIGHRES_CHECK;
+    wiiWait(10);
+    return;
   case WII_NUNCHUK:
     readFunction = readNunchukExt;
     break;
@@ -227,6 +325,10 @@ void initWiiExt(void) {
     readFunction = readUDrawExt;
     break;
   case WII_UBISOFT_DRAWSOME_TABLET:
+    twi_writeSingleToPointer(I2C_ADDR, 0xFB, 0x01);
+    _delay_us(10);
+    twi_writeSingleToPointer(I2C_ADDR, 0xF0, 0x55);
+    _delay_us(10);
     readFunction = readDrawsomeExt;
     break;
   case WII_DJ_HERO_TURNTABLE:
@@ -238,18 +340,129 @@ void initWiiExt(void) {
   default:
     wiiExtensionID = WII_NO_EXTENSION;
     readFunction = NULL;
+    wiiRetryLater();
+    return;
+  }
+  finishWiiInit();
+}
+void tickWiiExtInit(void) {
+  if (micros() - wiiStepTime < wiiStepDelay) return;
+  switch (wiiInitState) {
+  case WII_DETECT:
+    // Detect the extension at the default speed, as we don't know what it
+    // supports yet.
+    twi_setSpeed(TWI_SPEED_DEFAULT);
+    wiiExtensionID = readExtID();
+    wiiInitState =
+        wiiExtensionID == WII_NOT_INITIALISED ? WII_INIT_1 : WII_CONFIGURE;
+    wiiWait(10);
+    break;
+  case WII_INIT_1:
+    // Send packets needed to initialise a controller
+    twi_writeSingleToPointer(I2C_ADDR, 0xF0, 0x55);
+    wiiInitState = WII_INIT_2;
+    wiiWait(10);
+    break;
+  case WII_INIT_2:
+    twi_writeSingleToPointer(I2C_ADDR, 0xFB, 0x00);
+    wiiInitState = WII_REDETECT;
+    wiiWait(10);
+    break;
+  case WII_REDETECT:
+    wiiExtensionID = readExtID();
+    if (wiiExtensionID == WII_NOT_INITIALISED) {
+      wiiExtensionID = WII_NO_EXTENSION;
+      wiiRetryLater();
+      break;
+    }
+    wiiInitState = WII_CONFIGURE;
+    wiiWait(10);
+    break;
+  case WII_CONFIGURE:
+    configureWiiExt();
+    break;
+  case WII_HIGHRES_CHECK:
+    // Some controllers support high res mode, some dont. Some require it, some
+    // dont. To mitigate this issue, we can check if the high res specific
+    // bytes are zeroed. However this isnt enough. If a byte is corrupted during
+    // transit than it may be triggered. Reading twice will allow us to confirm
+    // that nothing was corrupted,
+    if (twi_readFromPointerSlow(I2C_ADDR, 0, sizeof(wiiCheck), wiiCheck)) {
+      wiiInitState = WII_HIGHRES_VALIDATE;
+    } else if (++wiiRetries == WII_HIGHRES_RETRIES) {
+      wiiRetryLater();
+      break;
+    }
+    wiiWait(200);
+    break;
+  case WII_HIGHRES_VALIDATE: {
+    uint8_t validate[8];
+    if (twi_readFromPointerSlow(I2C_ADDR, 0, sizeof(validate), validate) &&
+        memcmp(wiiCheck, validate, sizeof(validate)) == 0) {
+      bool highRes = (wiiCheck[0x06] || wiiCheck[0x07]);
+      if (highRes) {
+        readFunction = readClassicExtHighRes;
+        bytes = 8;
+      } else {
+        readFunction = readClassicExt;
+        bytes = 6;
+      }
+      finishWiiInit();
+      break;
+    }
+    if (++wiiRetries == WII_HIGHRES_RETRIES) {
+      wiiRetryLater();
+      break;
+    }
+    wiiInitState = WII_HIGHRES_CHECK;
+    wiiWait(200);
+    break;
+  }
+  case WII_SPEED_TEST:
+    tickWiiSpeedTest();
+    break;
   }
 }
 void tickWiiExtInput(Controller_t *controller) {
   uint8_t data[8];
-  if (wiiExtensionID == WII_NOT_INITIALISED ||
-      wiiExtensionID == WII_NO_EXTENSION ||
-      (twi_readFromPointerSlow(I2C_ADDR, 0x00, bytes, data) &&
-       !verifyData(data, bytes))) {
-    initWiiExt();
+  if (wiiInitState != WII_READY) {
+    tickWiiExtInit();
     return;
   }
-  if (readFunction) readFunction(controller, data);
+  // Reads happen in the background, so process the last read and then queue up
+  // the next one.
+  uint8_t state = twi_pollReadFromPointer(data);
+  if (state == TWI_ASYNC_BUSY) return;
+  if (state == TWI_ASYNC_ERROR) {
+    countWiiError();
+    // Nothing acknowledges reads once the extension is pulled out, so report
+    // neutral inputs and go back to detecting it. The errors were not the
+    // bus speed's fault, so whatever gets plugged in next is tested again.
+    if (++wiiFailedReads == WII_LOST_READS) {
+      wiiSpeedID = WII_NO_EXTENSION;
+      wiiErrors = 0;
+      resetWiiInputs(controller);
+      wiiRetryLater();
+      return;
+    }
+  } else if (state == TWI_ASYNC_DONE) {
+    wiiFailedReads = 0;
+    if (!verifyData(data, bytes)) {
+      // The extension was unplugged (or is being replugged), so report
+      // neutral inputs until it has been initialised again
+      countWiiError();
+      resetWiiInputs(controller);
+      wiiInitState = WII_DETECT;
+      return;
+    }
+    if (wiiErrors) wiiErrors--;
+  }
+  twi_startReadFromPointerSlow(I2C_ADDR, 0x00, bytes);
+  if (state != TWI_ASYNC_DONE || !readFunction) return;
+  if (lastWiiFrameValid && memcmp(data, lastWiiFrame, bytes) == 0) return;
+  memcpy(lastWiiFrame, data, bytes);
+  lastWiiFrameValid = true;
+  readFunction(controller, data);
 }
 bool readWiiButton(Pin_t pin) {
   uint8_t idx = wiiButtonBindings[pin.offset];
@@ -258,4 +471,11 @@ bool readWiiButton(Pin_t pin) {
 }
 void initWiiExtensions(Configuration_t *config) {
   mapNunchukAccelToRightJoy = config->main.mapNunchukAccelToRightJoy;
+  wiiInitState = WII_DETECT;
+  wiiBackoff = WII_BACKOFF_MIN;
+  // The MPU-6050 shares the bus, and it only supports fast mode
+  wiiMaxSpeed = (config->main.tiltType == MPU_6050 ||
+                 config->main.tiltType == MPU_6050_RAW)
+                    ? TWI_SPEED_DEFAULT
+                    : 0;
 }
\ No newline at end of file
@@ -4,16 +4,21 @@
 // #include "input_handler.h"
 // #include <avr/power.h>
 #include "spi/spi.h"
-bool ledsEnabled;
+bool ledsDisabled;
 Led_t ledConfig[XBOX_AXIS_COUNT + XBOX_BTN_COUNT];
 Led_t leds[XBOX_BTN_COUNT + XBOX_AXIS_COUNT];
 void initLEDs(Configuration_t* config) {
-  ledsEnabled = config->main.fretLEDMode != APA102;
+  ledsDisabled = config->main.fretLEDMode != APA102;
+#ifndef __AVR__
+  // On the pico, PS2 controllers are clocked by their own PIO engine on the
+  // same pins, and the APA102 engine is never started, so leave the leds off
+  if (config->main.inputType == PS2) { ledsDisabled = true; }
+#endif
   memcpy(ledConfig, config->leds, sizeof(leds));
 }
 void tickLEDs(Controller_t *controller) {
   // Don't do anything if the leds are disabled.
-  if (ledsEnabled) return;
+  if (ledsDisabled) return;
   int led = 0;
   for (uint8_t i = 0; i < 4; i++) { spi_transfer(0); }
   Led_t configLED;
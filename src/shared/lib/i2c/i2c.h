@@ -36,9 +36,22 @@
 #define TWI_MTX 2
 #define TWI_SRX 3
 #define TWI_STX 4
+#define TWI_WAIT 5
+
+// Bus speeds that can be selected with twi_setSpeed, from fastest to slowest.
+// twi_init uses TWI_SPEED_DEFAULT.
+#define TWI_SPEED_COUNT 4
+#define TWI_SPEED_DEFAULT 2
+
+// States returned by twi_pollReadFromPointer
+#define TWI_ASYNC_IDLE 0
+#define TWI_ASYNC_BUSY 1
+#define TWI_ASYNC_DONE 2
+#define TWI_ASYNC_ERROR 3
 
 void twi_init(void);
 void twi_disable(void);
+void twi_setSpeed(uint8_t speed);
 bool twi_readFrom(uint8_t, uint8_t *, uint8_t, uint8_t);
 bool twi_writeTo(uint8_t, uint8_t *, uint8_t, uint8_t, uint8_t);
 bool twi_readFromPointer(uint8_t address, uint8_t pointer, uint8_t length,
@@ -49,5 +62,8 @@ bool twi_readFromPointerSlow(uint8_t address, uint8_t pointer, uint8_t length,
 bool twi_writeSingleToPointer(uint8_t address, uint8_t pointer, uint8_t data);
 bool twi_writeToPointer(uint8_t address, uint8_t pointer, uint8_t length,
                         uint8_t *data);
+bool twi_startReadFromPointerSlow(uint8_t address, uint8_t pointer,
+                                  uint8_t length);
+uint8_t twi_pollReadFromPointer(uint8_t *data);
 
 #endif
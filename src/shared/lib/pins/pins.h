@@ -32,6 +32,28 @@ typedef struct {
   uint8_t analogOffset;
 } Pin_t;
 #endif
+// A whole GPIO port, as read in a single register access. AVR ports are 8 bits
+// wide, while the pico has a single bank containing every gpio.
+#ifdef __AVR__
+typedef uint8_t PortWord_t;
+#else
+typedef uint32_t PortWord_t;
+#endif
+// A set of digital pins that share a port. These are sampled together, so the
+// cost of a tick does not depend on the amount of pins.
+typedef struct {
+  const volatile PortWord_t *port;
+  PortWord_t mask;
+  // Pins that are pressed when high instead of low
+  PortWord_t eq;
+  // Debounced state, 1 = pressed
+  PortWord_t state;
+  // Pins that changed within their debounce time, which are not sampled
+  PortWord_t locked;
+  // Buttons handled by this group, and the buttons currently pressed
+  uint16_t buttonMask;
+  uint16_t buttons;
+} PortGroup_t;
 typedef struct {
   uint8_t offset;
   uint8_t pin;
@@ -44,6 +66,10 @@ typedef struct {
 
 extern AnalogInfo_t joyData[NUM_ANALOG_INPUTS];
 extern int validAnalog;
+#ifdef __AVR__
+// Incremented by the ADC interrupt every time all analog pins have been read
+extern volatile uint8_t adcSequence;
+#endif
 #define LOW 0
 #define CHANGE 1
 #define FALLING 2
@@ -60,4 +86,6 @@ void setUpValidPins(Configuration_t* config);
 void setUpAnalogDigitalPin(Pin_t* button, uint8_t pin, uint16_t threshold);
 Pin_t setUpDigital(Configuration_t* config, uint8_t pin, uint8_t offset, bool inverted, bool output);
 void digitalWritePin(Pin_t pin, bool value);
+const volatile PortWord_t *pinPortRegister(Pin_t pin);
+PortWord_t pinPortMask(Pin_t pin);
 void digitalWrite(uint8_t pin, uint8_t value);
\ No newline at end of file
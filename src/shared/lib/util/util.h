@@ -72,9 +72,16 @@
 
 #if __AVR__
 #  include <avr/interrupt.h>
+// Inputs are read by the main loop, so there is nothing to pause
+#  define pauseInputs()
+#  define resumeInputs()
 #else
 #  include "hardware/sync.h"
 extern void sei();
 extern void cli();
+// Pauses core 1, which reads inputs and drives the leds, while core 0 changes
+// state that it uses
+void pauseInputs(void);
+void resumeInputs(void);
 inline uint8_t pgm_read_byte(const uint8_t *ptr) { return *ptr; }
 #endif
\ No newline at end of file
@@ -35,7 +35,7 @@ AVR_CONST CompatibleDescriptorType DevCompatIDs = {
   Version : 0x0100,
   Index : EXTENDED_COMPAT_ID_DESCRIPTOR,
 #ifdef MULTI_ADAPTOR
-  TotalSections : 4,
+  TotalSections : 5,
 #else
   TotalSections : 2,
 #endif
@@ -55,21 +55,21 @@ AVR_CONST CompatibleDescriptorType DevCompatIDs = {
     Reserved2 : {0}
   },
 #ifdef MULTI_ADAPTOR
-  CompatID2 : {
+  CompatID3 : {
     FirstInterfaceNumber : INTERFACE_ID_XInput_2,
     Reserved : 0x04,
     CompatibleID : "XUSB10",
     SubCompatibleID : {0},
     Reserved2 : {0}
   },
-  CompatID3 : {
+  CompatID4 : {
     FirstInterfaceNumber : INTERFACE_ID_XInput_3,
     Reserved : 0x04,
     CompatibleID : "XUSB10",
     SubCompatibleID : {0},
     Reserved2 : {0}
   },
-  CompatID4 : {
+  CompatID5 : {
     FirstInterfaceNumber : INTERFACE_ID_XInput_4,
     Reserved : 0x04,
     CompatibleID : "XUSB10",
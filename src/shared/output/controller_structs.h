@@ -3,7 +3,9 @@
 #include "descriptors.h"
 #include <stdbool.h>
 
-#define SIMULTANEOUS_KEYS 6
+// Keyboard usages below the modifiers, each gets a bit in the report
+#define KEYBOARD_BITMAP_USAGES 0xE0
+#define KEYBOARD_BITMAP_SIZE (KEYBOARD_BITMAP_USAGES / 8)
 /** Type define for the gamepad HID report structure, for creating and sending
  * HID reports to the host PC. This mirrors the layout described to the host in
  * the HID report descriptor, in Descriptors.c.
@@ -68,12 +70,11 @@ typedef struct {
       Modifier;     /**< Keyboard modifier byte, indicating pressed modifier
                      * keys (a combination of   \c HID_KEYBOARD_MODIFER_* masks).
                      */
-  uint8_t Reserved; /**< Reserved for OEM use, always set to 0. */
-  uint8_t KeyCode[SIMULTANEOUS_KEYS]; /**< Key codes of the currently pressed
-                                         keys. */
+  uint8_t KeyBits[KEYBOARD_BITMAP_SIZE]; /**< One bit per keyboard usage,
+                                            set while that key is pressed. */
 } ATTR_PACKED USB_ID_KeyboardReport_Data_t;
 typedef union {
-  USB_KeyboardReport_Data_t keyboard;
+  USB_ID_KeyboardReport_Data_t keyboard;
   USB_PS3Report_Data_t ps3;
   USB_XInputReport_Data_t xinput;
   USB_MIDI_Data_t midi;
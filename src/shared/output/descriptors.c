@@ -154,9 +154,11 @@ AVR_CONST USB_Descriptor_HIDReport_Datatype_t kbd_report_descriptor[] = {
     HID_RI_REPORT_SIZE(8, 0x01),
     HID_RI_REPORT_COUNT(8, 0x08),
     HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-    HID_RI_REPORT_COUNT(8, 0x01),
-    HID_RI_REPORT_SIZE(8, 0x08),
-    HID_RI_INPUT(8, HID_IOF_CONSTANT),
+    // N-key rollover, every other key has its own bit
+    HID_RI_USAGE_MINIMUM(8, 0x00),
+    HID_RI_USAGE_MAXIMUM(8, KEYBOARD_BITMAP_USAGES - 1),
+    HID_RI_REPORT_COUNT(8, KEYBOARD_BITMAP_USAGES),
+    HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
     HID_RI_USAGE_PAGE(8, HID_USAGE_PAGE_LED),
     HID_RI_USAGE_MINIMUM(8, 0x01),
     HID_RI_USAGE_MAXIMUM(8, 0x05),
@@ -167,14 +169,6 @@ AVR_CONST USB_Descriptor_HIDReport_Datatype_t kbd_report_descriptor[] = {
     HID_RI_REPORT_COUNT(8, 0x01),
     HID_RI_REPORT_SIZE(8, 0x03),
     HID_RI_OUTPUT(8, HID_IOF_CONSTANT),
-    HID_RI_LOGICAL_MINIMUM(8, 0x00),
-    HID_RI_LOGICAL_MAXIMUM(16, 0xFF),
-    HID_RI_USAGE_PAGE(8, 0x07),
-    HID_RI_USAGE_MINIMUM(8, 0x00),
-    HID_RI_USAGE_MAXIMUM(8, 0xFF),
-    HID_RI_REPORT_COUNT(8, SIMULTANEOUS_KEYS),
-    HID_RI_REPORT_SIZE(8, 0x08),
-    HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_ARRAY | HID_IOF_ABSOLUTE),
     HID_RI_END_COLLECTION(0),
     HID_RI_USAGE_PAGE(8, HID_USAGE_PAGE_GENERIC_DESKTOP),
     HID_RI_USAGE(8, HID_USAGE_MOUSE),
@@ -54,7 +54,9 @@ void Endpoint_Write_Control_Stream_LE(const void *const Buffer,
 /** Endpoint address of the DEVICE IN endpoint. */
 #define MIDI_EPADDR_IN (ENDPOINT_DIR_IN | 3)
 /** Endpoint address of the DEVICE OUT endpoint. */
-#define XINPUT_2_EPADDR_IN (ENDPOINT_DIR_IN | 2)
+// The multi adaptor has no HID endpoints, so the second controller takes its
+// place
+#define XINPUT_2_EPADDR_IN (ENDPOINT_DIR_IN | 1)
 #define XINPUT_3_EPADDR_IN (ENDPOINT_DIR_IN | 3)
 #define XINPUT_4_EPADDR_IN (ENDPOINT_DIR_IN | 4)
 /** Endpoint address of the DEVICE IN endpoint. */
@@ -106,8 +108,10 @@ typedef struct {
   USB_Descriptor_Configuration_Header_t Config;
   USB_Descriptor_Interface_t InterfaceHID;
   USB_HID_Descriptor_HID_t HIDDescriptor;
+#ifndef MULTI_ADAPTOR
   USB_Descriptor_Endpoint_t EndpointInHID;
   USB_Descriptor_Endpoint_t EndpointOutHID;
+#endif
   USB_Descriptor_Interface_t InterfaceXInput;
   USB_HID_XBOX_Descriptor_HID_t XInputReserved;
   USB_Descriptor_Endpoint_t EndpointInXInput;
@@ -168,6 +172,7 @@ typedef struct {
   USB_OSCompatibleSection_t CompatID2;
   USB_OSCompatibleSection_t CompatID3;
   USB_OSCompatibleSection_t CompatID4;
+  USB_OSCompatibleSection_t CompatID5;
 } ATTR_PACKED USB_OSCompatibleIDDescriptor_4_t;
 typedef struct {
   uint32_t TotalLength;
@@ -265,7 +270,7 @@ extern AVR_CONST USB_Descriptor_String_t AVR_CONST productString;
 extern const USB_Descriptor_String_t *AVR_CONST descriptorStrings[];
 extern AVR_CONST USB_OSDescriptor_t OSDescriptorString;
 extern AVR_CONST USB_Descriptor_HIDReport_Datatype_t ps3_report_descriptor[137];
-extern AVR_CONST USB_Descriptor_HIDReport_Datatype_t kbd_report_descriptor[137];
+extern AVR_CONST USB_Descriptor_HIDReport_Datatype_t kbd_report_descriptor[122];
 extern AVR_CONST USB_Descriptor_Device_t deviceDescriptor;
 extern AVR_CONST USB_Descriptor_Configuration_t ConfigurationDescriptor;
 extern AVR_CONST uint16_t vid[];
@@ -10,8 +10,14 @@
 
 void (*fillReport)(void *ReportData, uint8_t *const ReportSize,
                    Controller_t *controller) = NULL;
+bool reportPending = false;
 
 void initReports(Configuration_t* config) {
+#ifdef MULTI_ADAPTOR
+  // Only the XInput interfaces exist on the multi adaptor
+  fillReport = fillXInputReport;
+  return;
+#endif
   if (fullDeviceType == MOUSE) {
     fillReport = fillMouseReport;
   } else if (fullDeviceType >= MIDI_GAMEPAD) {
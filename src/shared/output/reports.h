@@ -4,7 +4,12 @@
 #include "controller_structs.h"
 #include "eeprom/eeprom.h"
 #include "stdint.h"
+#include <stdbool.h>
 
 extern void (*fillReport)(void *ReportData, uint8_t *const ReportSize,
                           Controller_t *controller);
-void initReports(Configuration_t* config);
\ No newline at end of file
+void initReports(Configuration_t* config);
+// Set when a report could not hold everything that changed, so another one
+// should be sent even if the inputs stay the same
+extern bool reportPending;
+void returnMIDIEvents(uint8_t count);
\ No newline at end of file
@@ -4,23 +4,32 @@
 #include "output/controller_structs.h"
 #include "output/descriptors.h"
 #include <stdint.h>
-#define CHECK_JOY_KEY(joy)                                                     \
-  checkJoyKey(keysConfig.joy.neg, keysConfig.joy.pos, controller->joy,       \
-              joyThresholdKb, &usedKeys, KeyboardReport)
-#define CHECK_TRIGGER_KEY(trigger)                                             \
-  checkJoyKey(0, keysConfig.trigger, controller->trigger, triggerThresholdKb, \
-              &usedKeys, KeyboardReport)
+#include <string.h>
 
+// Where a key lives in the report, relative to the modifier byte. Unbound keys
+// have a mask of 0, so setting them does nothing.
+typedef struct {
+  uint8_t offset;
+  uint8_t mask;
+} KeyBit_t;
+
+KeyBit_t buttonKeys[XBOX_BTN_COUNT];
+KeyBit_t triggerKeys[2];
+// neg and pos for each stick axis
+KeyBit_t stickKeys[4][2];
 int joyThresholdKb;
-int triggerThresholdKb;
-//TODO: Maybe we should overlay this with midi
-Keys_t keysConfig;
-void checkJoyKey(int neg, int pos, int val, int thresh, uint8_t *used,
-                 USB_ID_KeyboardReport_Data_t *KeyboardReport) {
-  if (*used < SIMULTANEOUS_KEYS) {
-    if (neg && val < -thresh) { KeyboardReport->KeyCode[*used++] = neg; }
-    if (pos && val > thresh) { KeyboardReport->KeyCode[*used++] = pos; }
+uint8_t triggerThresholdKb;
+
+KeyBit_t getKeyBit(uint8_t usage) {
+  KeyBit_t key = {0, 0};
+  if (usage >= KEYBOARD_BITMAP_USAGES) {
+    // Left control through right gui are the bits of the modifier byte
+    if (usage <= 0xE7) { key.mask = _BV(usage - 0xE0); }
+  } else if (usage) {
+    key.offset = 1 + (usage >> 3);
+    key.mask = _BV(usage & 7);
   }
+  return key;
 }
 void fillKeyboardReport(void *ReportData, uint8_t *const ReportSize,
                         Controller_t *controller) {
@@ -28,23 +37,41 @@ void fillKeyboardReport(void *ReportData, uint8_t *const ReportSize,
   USB_ID_KeyboardReport_Data_t *KeyboardReport =
       (USB_ID_KeyboardReport_Data_t *)ReportData;
   KeyboardReport->rid = REPORT_ID_KBD;
-  uint8_t usedKeys = 0;
-  uint8_t *keys = (uint8_t *)&keysConfig;
-  for (int i = 0; i <= XBOX_Y && usedKeys < SIMULTANEOUS_KEYS; i++) {
-    uint8_t binding = keys[i];
-    if (binding && bit_check(controller->buttons, i)) {
-      KeyboardReport->KeyCode[usedKeys++] = binding;
+  uint8_t *keys = &KeyboardReport->Modifier;
+  memset(keys, 0, sizeof(USB_ID_KeyboardReport_Data_t) - 1);
+  uint16_t buttons = controller->buttons;
+  for (KeyBit_t *key = buttonKeys; buttons; key++, buttons >>= 1) {
+    if (buttons & 1) { keys[key->offset] |= key->mask; }
+  }
+  ControllerCombined_t *combined = (ControllerCombined_t *)controller;
+  for (uint8_t i = 0; i < 2; i++) {
+    if (combined->triggers[i] > triggerThresholdKb) {
+      keys[triggerKeys[i].offset] |= triggerKeys[i].mask;
+    }
+  }
+  for (uint8_t i = 0; i < 4; i++) {
+    int16_t val = combined->sticks[i];
+    KeyBit_t *key = NULL;
+    if (val < -joyThresholdKb) {
+      key = &stickKeys[i][0];
+    } else if (val > joyThresholdKb) {
+      key = &stickKeys[i][1];
     }
+    if (key) { keys[key->offset] |= key->mask; }
   }
-  CHECK_JOY_KEY(l_x);
-  CHECK_JOY_KEY(l_y);
-  CHECK_JOY_KEY(r_x);
-  CHECK_JOY_KEY(r_y);
-  CHECK_TRIGGER_KEY(lt);
-  CHECK_TRIGGER_KEY(rt);
 }
-void initKeyboard(Configuration_t* config) {
-  keysConfig = config->keys;
+void initKeyboard(Configuration_t *config) {
+  uint8_t *buttons = (uint8_t *)&config->keys;
+  for (uint8_t i = 0; i < XBOX_BTN_COUNT; i++) {
+    buttonKeys[i] = getKeyBit(buttons[i]);
+  }
+  triggerKeys[0] = getKeyBit(config->keys.lt);
+  triggerKeys[1] = getKeyBit(config->keys.rt);
+  AnalogKey_t *sticks = &config->keys.l_x;
+  for (uint8_t i = 0; i < 4; i++) {
+    stickKeys[i][0] = getKeyBit(sticks[i].neg);
+    stickKeys[i][1] = getKeyBit(sticks[i].pos);
+  }
   joyThresholdKb = config->axis.joyThreshold << 8;
-  triggerThresholdKb = config->axis.triggerThreshold << 8;
-}
\ No newline at end of file
+  triggerThresholdKb = config->axis.triggerThreshold;
+}
@@ -5,36 +5,182 @@
 #include "midi.h"
 #include "output/controller_structs.h"
 #include "output/descriptors.h"
+#include "output/reports.h"
 #include <stdint.h>
+#include <string.h>
 
-uint8_t lastmidi[XBOX_BTN_COUNT + XBOX_AXIS_COUNT];
-MidiConfig_t midiConfig;
+#define MIDI_SLOTS (XBOX_BTN_COUNT + XBOX_AXIS_COUNT)
+// Buttons that carry a drum pad velocity instead of a fixed one
+#define MIDI_DRUM_SLOTS 0xFE00
+// Must be a power of two. Slots that do not fit are retried on the next report.
+#define MIDI_QUEUE_SIZE 32
+// Events that fit in a single bulk packet on the MIDI endpoint
+#define MIDI_EVENTS_PER_REPORT (HID_EPSIZE / sizeof(MIDI_EventPacket_t))
+// Velocity sent for buttons and axes, kept at what older firmware sent so
+// existing mappings keep working
+#define MIDI_BUTTON_VELOCITY (MIDI_STANDARD_VELOCITY >> 1)
+
+typedef struct {
+  // Status byte, command | channel
+  uint8_t status;
+  uint8_t note;
+} MidiSlot_t;
+
+MidiSlot_t midiSlots[MIDI_SLOTS];
+uint32_t midiEnabled;
+// Slots that still need to be looked at even though their inputs have not
+// changed, either because the queue was full or because we were just started
+uint32_t midiRetry;
+uint8_t lastmidi[MIDI_SLOTS];
+ControllerCombined_t midiLast;
+uint8_t midiLastDrums[sizeof(drumVelocity)];
+uint8_t midiCurve[MIDI_CURVE_POINTS];
+int midiJoyThreshold;
+uint8_t midiTriggerThreshold;
+
+// Events waiting to be sent, head and tail run freely and are masked on use
+MIDI_EventPacket_t midiQueue[MIDI_QUEUE_SIZE];
+uint8_t midiQueueSlot[MIDI_QUEUE_SIZE];
+uint8_t midiHead;
+uint8_t midiTail;
+// Queue position + 1 of the newest unsent event for each slot, or 0
+uint8_t midiPending[MIDI_SLOTS];
+
+// Maps a raw drum velocity through the configured curve, which has points
+// every 32 steps of the raw value
+uint8_t applyVelocityCurve(uint8_t raw) {
+  uint8_t i = raw >> 5;
+  int16_t low = midiCurve[i];
+  int16_t high = midiCurve[i + 1];
+  int16_t vel = low + (((high - low) * (raw & 31)) >> 5);
+  if (vel > 127) vel = 127;
+  // A hit that the curve maps to nothing would otherwise read as a note off
+  if (vel < 1) vel = 1;
+  return vel;
+}
+uint8_t getMIDIValue(ControllerCombined_t *controller, uint8_t slot) {
+  bool cc = (midiSlots[slot].status & 0xF0) == MIDI_COMMAND_CONTROL_CHANGE;
+  if (slot < XBOX_BTN_COUNT) {
+    if (typeIsDrum && bit_check(MIDI_DRUM_SLOTS, slot)) {
+      uint8_t raw = drumVelocity[slot - 8];
+      if (!raw) return 0;
+      return cc ? raw >> 1 : applyVelocityCurve(raw);
+    }
+    return bit_check(controller->buttons, slot) ? MIDI_BUTTON_VELOCITY : 0;
+  }
+  slot -= XBOX_BTN_COUNT;
+  if (slot < 2) {
+    uint8_t trigger = controller->triggers[slot];
+    if (cc) return trigger >> 1;
+    return trigger > midiTriggerThreshold ? MIDI_BUTTON_VELOCITY : 0;
+  }
+  int16_t stick = controller->sticks[slot - 2];
+  if (cc) return ((uint16_t)stick + 0x8000) >> 9;
+  return stick > midiJoyThreshold || stick < -midiJoyThreshold
+             ? MIDI_BUTTON_VELOCITY
+             : 0;
+}
+// Slots whose inputs differ from the last scan
+uint32_t getMIDIChanges(ControllerCombined_t *controller) {
+  uint32_t changed = controller->buttons ^ midiLast.buttons;
+  if (typeIsDrum &&
+      memcmp(drumVelocity, midiLastDrums, sizeof(midiLastDrums))) {
+    memcpy(midiLastDrums, drumVelocity, sizeof(midiLastDrums));
+    changed |= MIDI_DRUM_SLOTS;
+  }
+  for (uint8_t i = 0; i < 2; i++) {
+    if (controller->triggers[i] != midiLast.triggers[i]) {
+      changed |= (uint32_t)1 << (XBOX_BTN_COUNT + i);
+    }
+  }
+  for (uint8_t i = 0; i < 4; i++) {
+    if (controller->sticks[i] != midiLast.sticks[i]) {
+      changed |= (uint32_t)1 << (XBOX_BTN_COUNT + 2 + i);
+    }
+  }
+  midiLast = *controller;
+  return changed & midiEnabled;
+}
+bool queueMIDIEvent(uint8_t slot, uint8_t value) {
+  MidiSlot_t *midiSlot = &midiSlots[slot];
+  // An unsent event for the same slot can be updated in place, as long as it
+  // is the same kind of event. An unsent note on followed by a note off must
+  // stay as two events though, or quick drum hits would never reach the host.
+  if (midiPending[slot]) {
+    MIDI_EventPacket_t *pending = &midiQueue[midiPending[slot] - 1];
+    bool cc = (midiSlot->status & 0xF0) == MIDI_COMMAND_CONTROL_CHANGE;
+    if (cc || (pending->Data3 && value)) {
+      pending->Data3 = value;
+      return true;
+    }
+  }
+  if ((uint8_t)(midiHead - midiTail) == MIDI_QUEUE_SIZE) return false;
+  uint8_t pos = midiHead++ & (MIDI_QUEUE_SIZE - 1);
+  MIDI_EventPacket_t *event = &midiQueue[pos];
+  event->Event = MIDI_EVENT(0, midiSlot->status & 0xF0);
+  event->Data1 = midiSlot->status;
+  event->Data2 = midiSlot->note;
+  event->Data3 = value;
+  midiQueueSlot[pos] = slot;
+  midiPending[slot] = pos + 1;
+  return true;
+}
 void fillMIDIReport(void *ReportData, uint8_t *const ReportSize,
                     Controller_t *controller) {
+  ControllerCombined_t *combined = (ControllerCombined_t *)controller;
+  uint32_t changed = getMIDIChanges(combined) | midiRetry;
+  midiRetry = 0;
+  for (uint8_t slot = 0; changed; slot++, changed >>= 1) {
+    if (!(changed & 1)) continue;
+    uint8_t value = getMIDIValue(combined, slot);
+    if (lastmidi[slot] == value) continue;
+    if (!queueMIDIEvent(slot, value)) {
+      midiRetry |= (uint32_t)1 << slot;
+      continue;
+    }
+    lastmidi[slot] = value;
+  }
   USB_MIDI_Data_t *data = ReportData;
   data->rid = REPORT_ID_MIDI;
   uint8_t idx = 0;
-  for (int i = 0; i < XBOX_BTN_COUNT + XBOX_AXIS_COUNT; i++) {
-    if (midiConfig.type[i] != DISABLED) {
-      // Channel 10(percussion)
-      uint8_t channel = midiConfig.channel[i];
-      uint8_t midipitch = midiConfig.note[i];
-      uint8_t midicommand = midiConfig.type[i] == NOTE
-                                ? MIDI_COMMAND_NOTE_ON
-                                : MIDI_COMMAND_CONTROL_CHANGE;
-      uint8_t vel = getVelocity(controller, i) >> 1;
-      if (lastmidi[i] == vel) continue;
-      lastmidi[i] = vel;
-      data->midi[idx].Event = MIDI_EVENT(0, midicommand);
-      data->midi[idx].Data1 = midicommand | channel;
-      data->midi[idx].Data2 = midipitch;
-      data->midi[idx].Data3 = vel;
-      idx++;
-    }
+  while (idx < MIDI_EVENTS_PER_REPORT && midiTail != midiHead) {
+    uint8_t pos = midiTail++ & (MIDI_QUEUE_SIZE - 1);
+    uint8_t slot = midiQueueSlot[pos];
+    if (midiPending[slot] == pos + 1) midiPending[slot] = 0;
+    data->midi[idx++] = midiQueue[pos];
   }
-
-  *ReportSize = 1 + idx * sizeof(MIDI_EventPacket_t);
+  // Anything left over goes out in the following packets
+  reportPending = midiTail != midiHead || midiRetry;
+  *ReportSize = idx ? 1 + idx * sizeof(MIDI_EventPacket_t) : 0;
+}
+// Puts the last count events from the previous report back at the front of
+// the queue, for when the usb stack could not take all of them
+void returnMIDIEvents(uint8_t count) {
+  if (!count) return;
+  midiTail -= count;
+  reportPending = true;
+}
+void initMIDI(Configuration_t *config) {
+  MidiConfig_t *midiConfig = &config->midi;
+  midiEnabled = 0;
+  for (uint8_t i = 0; i < MIDI_SLOTS; i++) {
+    if (midiConfig->type[i] == DISABLED) continue;
+    midiSlots[i].status = (midiConfig->type[i] == NOTE
+                               ? MIDI_COMMAND_NOTE_ON
+                               : MIDI_COMMAND_CONTROL_CHANGE) |
+                          midiConfig->channel[i];
+    midiSlots[i].note = midiConfig->note[i];
+    midiEnabled |= (uint32_t)1 << i;
+  }
+  memcpy(midiCurve, config->midiVelocityCurve, sizeof(midiCurve));
+  midiJoyThreshold = config->axis.joyThreshold << 8;
+  midiTriggerThreshold = config->axis.triggerThreshold;
+  memset(lastmidi, 0, sizeof(lastmidi));
+  memset(midiPending, 0, sizeof(midiPending));
+  memset(&midiLast, 0, sizeof(midiLast));
+  memset(midiLastDrums, 0, sizeof(midiLastDrums));
+  midiHead = midiTail = 0;
+  // Report the starting state of every slot
+  midiRetry = midiEnabled;
+  reportPending = midiRetry;
 }
-void initMIDI(Configuration_t* config) {
-  midiConfig = config->midi;
-}
\ No newline at end of file
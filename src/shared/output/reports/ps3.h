@@ -5,7 +5,7 @@
 #include "eeprom/eeprom.h"
 #include "output/controller_structs.h"
 // Bindings to go from controller to ps3
-static uint8_t ps3ButtonBindings[] = {
+static const uint8_t PROGMEM ps3ButtonBindings[] = {
     XBOX_Y,    XBOX_A,     XBOX_B,          XBOX_X,
     0xff,      0xff,       XBOX_LB,         XBOX_RB,
     XBOX_BACK, XBOX_START, XBOX_LEFT_STICK, XBOX_RIGHT_STICK,
@@ -37,102 +37,136 @@ static const uint8_t PROGMEM ps3DrumButtonBindings[] = {XBOX_Y,
                                                         XBOX_RIGHT_STICK,
                                                         XBOX_HOME,
                                                         XBOX_UNUSED};
-static uint8_t ps3AxisBindings[] = {
+// Buttons that PS3 gamepad axes fall back to when there is no pressure
+static const uint8_t PROGMEM ps3AxisBindings[] = {
     XBOX_DPAD_UP, XBOX_DPAD_RIGHT, XBOX_DPAD_DOWN, XBOX_DPAD_LEFT, 0xFF,
     0xFF,         XBOX_LB,         XBOX_RB,        XBOX_Y,         XBOX_B,
     XBOX_A,       XBOX_X};
-static const uint8_t ghAxisBindings[] = {XBOX_DPAD_LEFT,  XBOX_DPAD_DOWN,
-                                         XBOX_DPAD_RIGHT, XBOX_DPAD_UP,
-                                         XBOX_X,          XBOX_B};
-// Annoyingly, axis bindings for GH guitars overlap. This is the set of axis
-// that overlap the previous list.
-static const uint8_t PROGMEM ghAxisBindings2[] = {0xff, XBOX_LB, XBOX_Y,
-                                                  XBOX_A};
 static const uint8_t hat_bindings[] = {0x08, 0x00, 0x04, 0x08, 0x06, 0x07,
                                        0x05, 0x08, 0x02, 0x01, 0x03};
-uint8_t currentAxisBindingsLen = 0;
-void initPS3(void) {
-  if (fullDeviceType > SWITCH_GAMEPAD) {
-    if (fullDeviceType > PS3_GAMEPAD) {
-      memcpy_P(ps3AxisBindings, ghAxisBindings, sizeof(ghAxisBindings));
-      currentAxisBindingsLen = sizeof(ghAxisBindings);
+// Report buttons are built from a list of ops generated by initPS3 for the
+// current subtype, followed by a finisher that fills in the subtype specific
+// axes, so that building a report doesn't need to look at the subtype.
+typedef struct {
+  uint8_t src;
+  uint8_t dest;
+} PS3ButtonOp_t;
+PS3ButtonOp_t ps3ButtonOps[sizeof(ps3ButtonBindings)];
+uint8_t ps3ButtonOpCount = 0;
+// The leading ops that also mirror their button onto the matching axis
+uint8_t ps3AxisOpCount = 0;
+uint16_t ps3PressureMasks[sizeof(ps3AxisBindings)];
+void (*ps3Finisher)(USB_PS3Report_Data_t *report, Controller_t *controller);
+
+void ps3CenterLeftStick(USB_PS3Report_Data_t *report) {
+  // l_x and l_y are unused on guitars and drums. Center them.
+  report->l_x = 0x80;
+  report->l_y = 0x80;
+}
+void ps3WriteSticks(USB_PS3Report_Data_t *report, Controller_t *controller) {
+  bit_write(controller->lt > 50, report->buttons, SWITCH_L);
+  bit_write(controller->rt > 50, report->buttons, SWITCH_R);
+  report->axis[4] = controller->lt;
+  report->axis[5] = controller->rt;
+  report->l_x = (controller->l_x >> 8) + 128;
+  report->l_y = (controller->l_y >> 8) + 128;
+  report->r_x = (controller->r_x >> 8) + 128;
+  report->r_y = (controller->r_y >> 8) + 128;
+}
+void ps3FinishGHGuitar(USB_PS3Report_Data_t *report, Controller_t *controller) {
+  report->r_x = (controller->r_x >> 9) + 128 + 64;
+  // GH PS3 guitars have a tilt axis, this seems to be how my ps3 guitar is
+  // mapped.
+  report->accel[0] = controller->r_y == 32767 ? -4000 : 7975;
+  // r_y is tap, so lets disable it.
+  report->r_y = 0x7d;
+  ps3CenterLeftStick(report);
+}
+void ps3FinishRBGuitar(USB_PS3Report_Data_t *report, Controller_t *controller) {
+  report->r_x = 128 + (controller->r_x >> 8);
+  // RB PS3 guitars use R for a tilt bit
+  bit_write(controller->r_y == 32767, report->buttons, SWITCH_R);
+  // r_y is the tone switch. Since lt isnt used, but r_y gets used by tilt, we
+  // map fx to lt, and then fix it here
+  report->r_y = 128 - controller->lt;
+  ps3CenterLeftStick(report);
+}
+void ps3FinishDrums(USB_PS3Report_Data_t *report, Controller_t *controller) {
+  ps3CenterLeftStick(report);
+}
+void ps3FinishGamepad(USB_PS3Report_Data_t *report, Controller_t *controller) {
+  // Pass pressures straight through, falling back to the digital state for
+  // buttons that don't report one.
+  for (uint8_t i = 0; i < sizeof(ps3AxisBindings); i++) {
+    uint8_t pressure = controller->pressures[i];
+    if (!pressure && (controller->buttons & ps3PressureMasks[i])) {
+      pressure = 0xFF;
     }
+    report->axis[i] = pressure;
   }
-  if (fullDeviceType == SWITCH_GAMEPAD) {
-    ps3ButtonBindings[SWITCH_B] = XBOX_B;
-    ps3ButtonBindings[SWITCH_A] = XBOX_A;
-  }
+  ps3WriteSticks(report, controller);
+}
+void ps3FinishSwitch(USB_PS3Report_Data_t *report, Controller_t *controller) {
+  ps3WriteSticks(report, controller);
+  report->l_y = 255 - report->l_y;
+  report->r_y = 255 - report->r_y;
+}
+void initPS3(void) {
+  const uint8_t *bindings = ps3ButtonBindings;
+  ps3Finisher = ps3FinishDrums;
   if (fullDeviceType == PS3_GUITAR_HERO_DRUMS ||
       fullDeviceType == PS3_ROCK_BAND_DRUMS) {
-    memcpy_P(ps3ButtonBindings, ps3DrumButtonBindings,
-             sizeof(ps3DrumButtonBindings));
+    bindings = ps3DrumButtonBindings;
   } else if (fullDeviceType == PS3_GUITAR_HERO_GUITAR) {
-    memcpy_P(ps3ButtonBindings, psGHButtonBindings, sizeof(ps3ButtonBindings));
+    bindings = psGHButtonBindings;
+    ps3Finisher = ps3FinishGHGuitar;
   } else if (fullDeviceType == PS3_ROCK_BAND_GUITAR ||
              fullDeviceType == WII_ROCK_BAND_GUITAR) {
-    memcpy_P(ps3ButtonBindings, psRBButonBindings, sizeof(ps3ButtonBindings));
+    bindings = psRBButonBindings;
+    ps3Finisher = ps3FinishRBGuitar;
+  } else if (fullDeviceType == PS3_GAMEPAD) {
+    ps3Finisher = ps3FinishGamepad;
+  } else if (fullDeviceType == SWITCH_GAMEPAD) {
+    ps3Finisher = ps3FinishSwitch;
+  }
+  ps3ButtonOpCount = ps3AxisOpCount = 0;
+  for (uint8_t i = 0; i < sizeof(ps3ButtonBindings); i++) {
+    uint8_t button = pgm_read_byte(bindings + i);
+    // A and B are swapped on the switch
+    if (fullDeviceType == SWITCH_GAMEPAD && i == SWITCH_B) button = XBOX_B;
+    if (fullDeviceType == SWITCH_GAMEPAD && i == SWITCH_A) button = XBOX_A;
+    if (button == 0xff) continue;
+    PS3ButtonOp_t *op = &ps3ButtonOps[ps3ButtonOpCount++];
+    op->src = button;
+    op->dest = i;
+    // The wii rb instruments also report the first six buttons as axes
+    if (fullDeviceType > PS3_GAMEPAD && i < 6) { ps3AxisOpCount++; }
+  }
+  for (uint8_t i = 0; i < sizeof(ps3AxisBindings); i++) {
+    uint8_t button = pgm_read_byte(ps3AxisBindings + i);
+    ps3PressureMasks[i] = button == 0xFF ? 0 : _BV(button);
   }
 }
 void fillPS3Report(void *ReportData, uint8_t *const ReportSize,
-                       Controller_t *controller) {
+                   Controller_t *controller) {
   *ReportSize = sizeof(USB_PS3Report_Data_t);
   USB_PS3Report_Data_t *JoystickReport = (USB_PS3Report_Data_t *)ReportData;
   JoystickReport->rid = REPORT_ID_GAMEPAD;
-  uint8_t button;
-  for (uint8_t i = 0; i < sizeof(ps3ButtonBindings); i++) {
-    button = ps3ButtonBindings[i];
-    if (button == 0xff) continue;
-    bool bit_set = bit_check(controller->buttons, button);
-    bit_write(bit_set, JoystickReport->buttons, i);
-    if (i < currentAxisBindingsLen) {
-      button = ps3AxisBindings[i];
-      if (fullDeviceType == PS3_GUITAR_HERO_GUITAR &&
-          i < sizeof(ghAxisBindings2)) {
-        button = ghAxisBindings2[i];
-        bit_set |= bit_check(controller->buttons, button);
-      }
-      JoystickReport->axis[i] = bit_set ? 0xFF : 0x00;
-    }
+  uint16_t buttons = 0;
+  const PS3ButtonOp_t *op = ps3ButtonOps;
+  for (const PS3ButtonOp_t *end = op + ps3AxisOpCount; op < end; op++) {
+    bool set = bit_check(controller->buttons, op->src);
+    if (set) bit_set(buttons, op->dest);
+    JoystickReport->axis[op->dest] = set ? 0xFF : 0x00;
+  }
+  for (const PS3ButtonOp_t *end = ps3ButtonOps + ps3ButtonOpCount; op < end;
+       op++) {
+    if (bit_check(controller->buttons, op->src)) bit_set(buttons, op->dest);
   }
+  JoystickReport->buttons = buttons;
 
   // Hat Switch
-  button = controller->buttons & 0xF;
-  JoystickReport->hat = button > 0x0a ? 0x08 : hat_bindings[button];
-
-  // Tilt / whammy
-  bool tilt = controller->r_y == 32767;
-  if (fullDeviceType == PS3_GUITAR_HERO_GUITAR) {
-    JoystickReport->r_x = (controller->r_x >> 9) + 128 + 64;
-    // GH PS3 guitars have a tilt axis, this seems to be how my ps3 guitar is mapped.
-    JoystickReport->accel[0] = tilt ? -4000 : 7975;
-    // r_y is tap, so lets disable it.
-    JoystickReport->r_y = 0x7d;
-  } else if (fullDeviceType == PS3_ROCK_BAND_GUITAR ||
-             fullDeviceType == WII_ROCK_BAND_GUITAR) {
-    JoystickReport->r_x = 128 + (controller->r_x >> 8);
-    // RB PS3 guitars use R for a tilt bit
-    bit_write(tilt, JoystickReport->buttons, SWITCH_R);
-    // r_y is the tone switch. Since lt isnt used, but r_y gets used by tilt, we
-    // map fx to lt, and then fix it here
-    JoystickReport->r_y = 128 - controller->lt;
-  }
-  if (fullDeviceType == PS3_GAMEPAD ||
-      fullDeviceType == SWITCH_GAMEPAD) {
-    bit_write(controller->lt > 50, JoystickReport->buttons, SWITCH_L);
-    bit_write(controller->rt > 50, JoystickReport->buttons, SWITCH_R);
-    JoystickReport->axis[4] = controller->lt;
-    JoystickReport->axis[5] = controller->rt;
-    JoystickReport->l_x = (controller->l_x >> 8) + 128;
-    JoystickReport->l_y = (controller->l_y >> 8) + 128;
-    JoystickReport->r_x = (controller->r_x >> 8) + 128;
-    JoystickReport->r_y = (controller->r_y >> 8) + 128;
-  } else {
-    // l_x and l_y are unused on guitars and drums. Center them.
-    JoystickReport->l_x = 0x80;
-    JoystickReport->l_y = 0x80;
-  }
-  if (fullDeviceType == SWITCH_GAMEPAD) {
-    JoystickReport->l_y = 255-JoystickReport->l_y;
-    JoystickReport->r_y = 255-JoystickReport->r_y;
-  }
-}
\ No newline at end of file
+  uint8_t dpad = controller->buttons & 0xF;
+  JoystickReport->hat = dpad > 0x0a ? 0x08 : hat_bindings[dpad];
+  ps3Finisher(JoystickReport, controller);
+}
@@ -18,11 +18,21 @@ bool handleCommand(uint8_t cmd) {
   case COMMAND_JUMP_BOOTLOADER:
     bootloader();
     return false;
+  // Searching changes pins and state that inputs are being read from, so
+  // input reading is paused until it is set up
   case COMMAND_FIND_ANALOG:
-    if (!isRF) { findAnalogPin(); }
+    if (!isRF) {
+      pauseInputs();
+      findAnalogPin();
+      resumeInputs();
+    }
     break;
   case COMMAND_FIND_DIGITAL:
-    if (!isRF) { findDigitalPin(); }
+    if (!isRF) {
+      pauseInputs();
+      findDigitalPin();
+      resumeInputs();
+    }
     break;
   case COMMAND_WRITE_CONFIG:
     return false;
@@ -47,7 +57,10 @@ void processHIDWriteFeatureReport(uint8_t cmd, uint8_t data_len,
     data++;
     data_len--;
     uint8_t *dest = ((uint8_t *)leds) + offset;
+    // Keep the leds from being sent part way through an update
+    pauseInputs();
     while (data_len--) { *(dest++) = *(data++); }
+    resumeInputs();
     return;
   }
   case COMMAND_SET_SP: {
@@ -117,8 +130,10 @@ void processHIDReadFeatureReport(uint8_t cmd, uint8_t report, const void* reques
     }
   } else if (cmd == COMMAND_GET_FOUND) {
     size = 2;
+    pauseInputs();
     dbuf[1] = detectedPin;
     stopSearching();
+    resumeInputs();
   } else {
     size = sizeof(id) + 1;
     memcpy_P(dbuf + 1, id, sizeof(id));
@@ -93,14 +93,33 @@ int tickRFTX(uint8_t *data, uint8_t *arr, uint8_t len) {
   nrf24_send(data, len);
   return ret;
 }
+// Also receive on pipes 2 up to count. These pipes share the upper three bytes
+// of rxid, so a transmitter for pipe n uses rxid with n - 1 added to the low
+// byte (without carrying into the rest).
+void listenRFPipes(uint32_t rxid, uint8_t count) {
+  uint8_t enabled = _BV(ERX_P0) | _BV(ERX_P1);
+  nrf24_ce_digitalWrite(LOW);
+  for (uint8_t pipe = 2; pipe <= count && pipe <= 5; pipe++) {
+    nrf24_configRegister(RX_ADDR_P0 + pipe, (uint8_t)(rxid + pipe - 1));
+    enabled |= _BV(ERX_P0 + pipe);
+  }
+  nrf24_configRegister(EN_RXADDR, enabled);
+  nrf24_ce_digitalWrite(HIGH);
+}
 uint8_t id = 0;
+uint8_t rfPipe = 0;
+// Reads one payload per call. IRQ only falls again for packets that arrive
+// after RX_DR is cleared, so rf_interrupt stays set until the RX FIFO is empty.
 uint8_t tickRFInput(uint8_t *data, uint8_t len) {
-  if (rf_interrupt) {
-    rf_interrupt = false;
-    uint8_t status = nrf24_getStatus();
-    if (((status & 0B1110) >> 1) != 0x7) { return nrf24_getData(data, len); }
-  }
-  return false;
+  if (!rf_interrupt) return false;
+  rf_interrupt = false;
+  uint8_t status = nrf24_getStatus();
+  rfPipe = (status >> RX_P_NO) & 0x7;
+  // The pipe number reads as 7 once the RX FIFO is empty
+  if (rfPipe == 0x7) return false;
+  uint8_t ret = nrf24_getData(data, len);
+  if (!nrf24_rxFifoEmpty()) rf_interrupt = true;
+  return ret;
 }
 
 #ifdef __AVR__
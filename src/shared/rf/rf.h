@@ -1,11 +1,16 @@
 #include <stdint.h>
 #include "controller/controller.h"
 #include <stdbool.h>
+// Payloads that the nRF24L01 can hold in its RX FIFO
+#define RF_RX_FIFO_SIZE 3
 void initRF(bool tx, uint32_t txid, uint32_t rxid);
 uint8_t tickRFInput(uint8_t *controller, uint8_t len);
+void listenRFPipes(uint32_t rxid, uint8_t count);
 int tickRFTX(uint8_t *data2, uint8_t* data, uint8_t len);
 uint32_t generate_crc32(void);
 extern volatile bool rf_interrupt;
+// Pipe that the last packet from tickRFInput arrived on
+extern uint8_t rfPipe;
 
 extern bool p_type;
 extern bool wide_band;
\ No newline at end of file